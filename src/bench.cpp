@@ -0,0 +1,377 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+// Headless benchmark of the icon theme library, on synthetic theme trees.
+
+#include <wx/init.h>
+#include <wx/cmdline.h>
+#include <wx/image.h>
+#include <wx/imagpng.h>
+
+#include "fdicontheme.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <set>
+#include <thread>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct BenchOptions {
+    long depth = 3;        // Generated themes, each inheriting the next one, hicolor last
+    long dirs = 40;        // Directories per theme
+    long icons = 100;      // Icons per directory
+    double symlinks = 0.1; // Ratio of icon files being symlinks
+    long lookups = 20000;
+    long threads = 4;
+    std::filesystem::path root;
+    bool keep = false;
+};
+
+const int SIZES[] = {16, 22, 24, 32, 48, 64, 96, 128, 256};
+const int SIZE_COUNT = sizeof(SIZES) / sizeof(SIZES[0]);
+
+double Elapsed(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+void ReportOnce(const char* label, double us) {
+    printf("%-34s %12.2f ms\n", label, us / 1000);
+}
+
+// Throughput and latency percentiles of per-operation timings, in microseconds.
+void ReportLatencies(const char* label, std::vector<double> us) {
+    if (us.empty()) return;
+    double total = 0;
+    for (double t : us) total += t;
+    std::sort(us.begin(), us.end());
+    auto percentile = [&](double p) { return us[std::min(us.size() - 1, (size_t) (p * us.size()))]; };
+    printf("%-34s %9zu ops %12.0f ops/s   p50 %8.2f us  p90 %8.2f us  p99 %8.2f us  max %9.2f us\n",
+           label, us.size(), us.size() / (total / 1e6), percentile(0.5), percentile(0.9), percentile(0.99), us.back());
+}
+
+std::string PngBytes(int size) {
+    wxImage image(size, size);
+    image.InitAlpha();
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            image.SetRGB(x, y, x * 255 / size, y * 255 / size, 128);
+            image.SetAlpha(x, y, 255);
+        }
+    }
+    std::filesystem::path file = std::filesystem::temp_directory_path() / ("fdit_bench-" + std::to_string(getpid()) + ".png");
+    image.SaveFile(file.string(), wxBITMAP_TYPE_PNG);
+    std::ifstream input(file, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    std::filesystem::remove(file);
+    return bytes;
+}
+
+std::string IconName(long theme, long context, long icon) {
+    // One icon in four only exists in its theme, so lookups also walk down the chain.
+    if (icon % 4 == 0) {
+        return "t" + std::to_string(theme) + "-icon-ctx" + std::to_string(context) + "-" + std::to_string(icon);
+    }
+    return "icon-ctx" + std::to_string(context) + "-" + std::to_string(icon);
+}
+
+// Themes bench-0 .. bench-(depth-1) and hicolor, returns the icon names of the whole chain.
+std::vector<wxString> GenerateThemes(const BenchOptions& options) {
+    std::vector<std::string> pngs;
+    for (int size : SIZES) {
+        pngs.push_back(PngBytes(size));
+    }
+
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> ratio(0, 1);
+    std::set<std::string> names;
+    for (long theme = 0; theme <= options.depth; ++theme) {
+        std::string themeName = theme < options.depth ? "bench-" + std::to_string(theme) : "hicolor";
+        std::filesystem::path themePath = options.root / themeName;
+        std::filesystem::create_directories(themePath);
+
+        std::string dirList;
+        std::string sections;
+        for (long dir = 0; dir < options.dirs; ++dir) {
+            int size = SIZES[dir % SIZE_COUNT];
+            long context = dir / SIZE_COUNT;
+            std::string dirName = std::to_string(size) + "x" + std::to_string(size) + "/ctx" + std::to_string(context);
+            dirList += (dir > 0 ? "," : "") + dirName;
+            sections += "\n[" + dirName + "]\nSize=" + std::to_string(size) + "\nContext=Applications\nType=Threshold\n";
+
+            std::filesystem::path dirPath = themePath / dirName;
+            std::filesystem::create_directories(dirPath);
+            std::filesystem::path first;
+            for (long icon = 0; icon < options.icons; ++icon) {
+                std::string iconName = IconName(theme, context, icon);
+                names.insert(iconName);
+                std::filesystem::path file = dirPath / (iconName + ".png");
+                if (!first.empty() && ratio(random) < options.symlinks) {
+                    std::filesystem::create_symlink(first.filename(), file);
+                } else {
+                    std::ofstream(file, std::ios::binary) << pngs[dir % SIZE_COUNT];
+                    if (first.empty()) first = file;
+                }
+            }
+        }
+
+        std::ofstream index(themePath / "index.theme");
+        index << "[Icon Theme]\nName=" << themeName << "\nComment=Synthetic theme\n";
+        if (theme + 1 < options.depth) {
+            index << "Inherits=bench-" << theme + 1 << "\n";
+        }
+        index << "Directories=" << dirList << "\n" << sections;
+    }
+    return std::vector<wxString>(names.begin(), names.end());
+}
+
+long PeakRssKiB() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+void Run(const BenchOptions& options) {
+    auto start = Clock::now();
+    auto names = GenerateThemes(options);
+    printf("Generated %ld themes of %ld directories of %ld icons (%.0f%% symlinks) in %.0f ms, %zu names\n\n",
+           options.depth + 1, options.dirs, options.icons, options.symlinks * 100, Elapsed(start) / 1000, names.size());
+
+    wxString rootPath = options.root.string();
+    wxString cachePath = (options.root / "index-cache").string();
+    wxString rootTheme = "bench-0";
+
+    FreeDesktopIconProvider provider;
+    provider.SetIndexCacheDirectory(cachePath);
+    provider.SetLookupCacheCapacity(0);
+    start = Clock::now();
+    provider.AppendPath(rootPath);
+    ReportOnce("Discover (AppendPath)", Elapsed(start));
+
+    start = Clock::now();
+    provider.PreloadThemes(1);
+    ReportOnce("Preload", Elapsed(start));
+
+    // The first full lookup of a theme builds its index.
+    auto chain = provider.GetThemeChain(rootTheme);
+    start = Clock::now();
+    for (const auto& theme : *chain) {
+        theme->FindAllIcons(names.front());
+    }
+    ReportOnce("BuildCache (scan)", Elapsed(start));
+
+    {
+        FreeDesktopIconProvider warm;
+        warm.SetIndexCacheDirectory(cachePath);
+        warm.AppendPath(rootPath);
+        warm.PreloadThemes(1);
+        auto warmChain = warm.GetThemeChain(rootTheme);
+        start = Clock::now();
+        for (const auto& theme : *warmChain) {
+            theme->FindAllIcons(names.front());
+        }
+        ReportOnce("BuildCache (persistent index)", Elapsed(start));
+    }
+    printf("\n");
+
+    std::mt19937 random(7);
+    std::uniform_int_distribution<size_t> pick(0, names.size() - 1);
+    std::uniform_int_distribution<int> pickSize(0, 3);
+    const int sizes[] = {16, 24, 32, 48};
+    std::vector<wxString> hits;
+    std::vector<wxString> misses;
+    for (long i = 0; i < options.lookups; ++i) {
+        hits.push_back(names[pick(random)]);
+        misses.push_back(wxString::Format("missing-icon-%ld", i));
+    }
+
+    auto timeLookups = [&](const char* label, const std::vector<wxString>& queries) {
+        std::vector<double> us;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            auto t = Clock::now();
+            provider.FindIcon(rootTheme, queries[i], sizes[i % 4]);
+            us.push_back(Elapsed(t));
+        }
+        ReportLatencies(label, us);
+    };
+    timeLookups("FindIcon hit", hits);
+    timeLookups("FindIcon miss", misses);
+
+    provider.SetLookupCacheCapacity(4096);
+    std::vector<wxString> hot(hits.begin(), hits.begin() + std::min<size_t>(hits.size(), 1000));
+    timeLookups("FindIcon cached (cold)", hot);
+    timeLookups("FindIcon cached (warm)", hot);
+    provider.SetLookupCacheCapacity(0);
+
+    {
+        start = Clock::now();
+        auto results = provider.FindIcons(rootTheme, hits, 32);
+        double batch = Elapsed(start);
+        start = Clock::now();
+        for (const auto& name : hits) {
+            provider.FindIcon(rootTheme, name, 32);
+        }
+        double single = Elapsed(start);
+        printf("%-34s %12.2f ms, %.2fx faster than single lookups (%.2f ms)\n", "FindIcons batch", batch / 1000, single / batch, single / 1000);
+    }
+
+    {
+        std::vector<std::thread> threads;
+        start = Clock::now();
+        for (long t = 0; t < options.threads; ++t) {
+            threads.emplace_back([&, t]() {
+                for (size_t i = t; i < hits.size(); i += options.threads) {
+                    provider.FindIcon(rootTheme, hits[i], sizes[i % 4]);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        double us = Elapsed(start);
+        printf("%-34s %9zu ops %12.0f ops/s   %ld threads\n", "FindIcon concurrent", hits.size(), hits.size() / (us / 1e6), options.threads);
+    }
+    printf("\n");
+
+    {
+        size_t count = 0;
+        start = Clock::now();
+        provider.ForEachIconName(rootTheme, [&](const char*) { ++count; return true; });
+        ReportOnce("ForEachIconName (first)", Elapsed(start));
+        start = Clock::now();
+        provider.ForEachIconName(rootTheme, [&](const char*) { ++count; return true; });
+        ReportOnce("ForEachIconName", Elapsed(start));
+        start = Clock::now();
+        auto set = provider.GetIconNames(rootTheme);
+        ReportOnce("GetIconNames", Elapsed(start));
+        printf("%-34s %12zu\n", "Unique names", set.size());
+    }
+
+    {
+        start = Clock::now();
+        provider.SearchIconNames(rootTheme, "icon-ctx0-*", 100);
+        ReportOnce("SearchIconNames (index build)", Elapsed(start));
+        const char* queries[] = {"icon-ctx0-*", "*-17", "ctx1-5", "t1-*-3?"};
+        std::vector<double> us;
+        for (int i = 0; i < 1000; ++i) {
+            auto t = Clock::now();
+            provider.SearchIconNames(rootTheme, queries[i % 4], 100);
+            us.push_back(Elapsed(t));
+        }
+        ReportLatencies("SearchIconNames", us);
+    }
+    printf("\n");
+
+    {
+        // Bundles only decode on demand, so decode all their sizes like a cold cache would.
+        auto images = provider.GetImageCache();
+        std::vector<double> resolve;
+        std::vector<double> decode;
+        for (size_t i = 0; i < std::min<size_t>(hits.size(), 500); ++i) {
+            auto t = Clock::now();
+            provider.LoadIconBundle(hits[i]);
+            resolve.push_back(Elapsed(t));
+            t = Clock::now();
+            for (const auto& [size, file] : provider.FindAllIcons(hits[i])) {
+                images->Load(file.GetFullPath(), size);
+            }
+            decode.push_back(Elapsed(t));
+        }
+        ReportLatencies("LoadIconBundle", resolve);
+        ReportLatencies("Decode all sizes", decode);
+    }
+    auto stats = provider.GetStats();
+    printf("\n%-34s %zu directories, %zu files, %zu builds (%.2f ms), %zu cache loads\n", "Themes",
+           stats.themes.directoriesScanned, stats.themes.filesIndexed, stats.themes.indexBuilds,
+           stats.themes.indexBuildTime / 1000.0, stats.themes.cacheLoads);
+    printf("%-34s %zu found, %zu missing, %zu fallbacks (max depth %zu)\n", "Lookups",
+           stats.iconsFound, stats.iconsMissing, stats.fallbacks, stats.maxFallbackDepth);
+    printf("%-34s %zu images, %zu KiB\n", "Decoded", stats.imagesDecoded, stats.bytesDecoded / 1024);
+    printf("\n%-34s %12ld KiB\n", "Peak RSS", PeakRssKiB());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    wxInitializer initializer(argc, argv);
+    if (!initializer.IsOk()) {
+        fprintf(stderr, "Cannot initialize wxWidgets\n");
+        return 1;
+    }
+    wxImage::AddHandler(new wxPNGHandler);
+
+    static const wxCmdLineEntryDesc desc[] = {
+        {wxCMD_LINE_SWITCH, "h", "help", "Show this help", wxCMD_LINE_VAL_NONE, wxCMD_LINE_OPTION_HELP},
+        {wxCMD_LINE_OPTION, nullptr, "depth", "Generated themes in the inheritance chain (default 3)", wxCMD_LINE_VAL_NUMBER},
+        {wxCMD_LINE_OPTION, nullptr, "dirs", "Directories per theme (default 40)", wxCMD_LINE_VAL_NUMBER},
+        {wxCMD_LINE_OPTION, nullptr, "icons", "Icons per directory (default 100)", wxCMD_LINE_VAL_NUMBER},
+        {wxCMD_LINE_OPTION, nullptr, "symlinks", "Ratio of icon files being symlinks (default 0.1)", wxCMD_LINE_VAL_DOUBLE},
+        {wxCMD_LINE_OPTION, nullptr, "lookups", "Lookups per measure (default 20000)", wxCMD_LINE_VAL_NUMBER},
+        {wxCMD_LINE_OPTION, nullptr, "threads", "Threads of the concurrent lookups (default 4)", wxCMD_LINE_VAL_NUMBER},
+        {wxCMD_LINE_OPTION, nullptr, "root", "Where to generate the themes (default a temporary directory)"},
+        {wxCMD_LINE_SWITCH, nullptr, "keep", "Keep the generated themes"},
+        wxCMD_LINE_DESC_END
+    };
+    wxCmdLineParser parser(desc, argc, argv);
+    if (parser.Parse() != 0) return 1;
+
+    BenchOptions options;
+    parser.Found("depth", &options.depth);
+    parser.Found("dirs", &options.dirs);
+    parser.Found("icons", &options.icons);
+    parser.Found("symlinks", &options.symlinks);
+    parser.Found("lookups", &options.lookups);
+    parser.Found("threads", &options.threads);
+    options.keep = parser.Found("keep");
+    wxString root;
+    if (parser.Found("root", &root)) {
+        options.root = root.ToStdString();
+    } else {
+        options.root = std::filesystem::temp_directory_path() / ("fdit_bench-" + std::to_string(getpid()));
+    }
+    options.depth = std::max(1L, options.depth);
+    options.dirs = std::max(1L, options.dirs);
+    options.icons = std::max(1L, options.icons);
+    options.threads = std::max(1L, options.threads);
+    options.lookups = std::max(1L, options.lookups);
+
+    if (std::filesystem::exists(options.root / "bench-0")) {
+        fprintf(stderr, "%s already holds generated themes\n", options.root.c_str());
+        return 1;
+    }
+
+    Run(options);
+
+    if (!options.keep) {
+        std::filesystem::remove_all(options.root);
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#ifndef WXFDICONTHEME_CACHEUTIL_H
+#define WXFDICONTHEME_CACHEUTIL_H
+
+#include <wx/filename.h>
+#include <wx/string.h>
+#include <wx/utils.h>
+
+#include <cstdint>
+#include <string_view>
+
+// Internal helpers shared by the on-disk caches, not part of the library interface.
+
+// FNV-1a, stable across runs and platforms unlike std::hash, so usable in cache file names.
+constexpr uint64_t FNV1A_OFFSET = 14695981039346656037ULL;
+
+constexpr uint64_t Fnv1a(uint64_t hash, unsigned char byte) {
+    return (hash ^ byte) * 1099511628211ULL;
+}
+
+constexpr uint64_t Fnv1a(std::string_view bytes) {
+    uint64_t hash = FNV1A_OFFSET;
+    for (char c : bytes) {
+        hash = Fnv1a(hash, (unsigned char) c);
+    }
+    return hash;
+}
+
+/** Hash of the UTF-8 form of the text. */
+inline uint64_t HashUtf8(const wxString& text) {
+    const wxScopedCharBuffer utf8 = text.utf8_str();
+    return Fnv1a(std::string_view(utf8.data(), utf8.length()));
+}
+
+/** $XDG_CACHE_HOME/wxFDIconTheme, or ~/.cache/wxFDIconTheme */
+inline wxString GetUserCacheDirectory() {
+    wxString cacheHome;
+    if (!wxGetEnv("XDG_CACHE_HOME", &cacheHome) || cacheHome.IsEmpty()) {
+        cacheHome = wxFileName(wxGetHomeDir(), ".cache").GetFullPath();
+    }
+    return wxFileName(cacheHome, "wxFDIconTheme").GetFullPath();
+}
+
+#endif //WXFDICONTHEME_CACHEUTIL_H
@@ -22,15 +22,20 @@
 */
 
 #include "dvcard.h"
+#include "trace.h"
 
 #include <wx/dcbuffer.h>
 
+#include <algorithm>
+
 IMPLEMENT_DYNAMIC_CLASS(wxDataViewCardCtrl, wxDataViewCtrl)
 
 BEGIN_EVENT_TABLE(wxDataViewCardCtrl, wxDataViewCtrl)
     EVT_PAINT(wxDataViewCardCtrl::OnPaint)
     EVT_SIZE(wxDataViewCardCtrl::OnSize)
     EVT_SCROLLWIN(wxDataViewCardCtrl::OnScroll)
+    EVT_MOUSEWHEEL(wxDataViewCardCtrl::OnMouseWheel)
+    EVT_TIMER(wxID_ANY, wxDataViewCardCtrl::OnScrollTimer)
 END_EVENT_TABLE()
 
 wxDataViewCardCtrl::wxDataViewCardCtrl() :
@@ -69,6 +74,7 @@ void wxDataViewCardCtrl::CommonInit()
 {
     wxWindow::SetBackgroundStyle(wxBG_STYLE_PAINT);
     SetBackgroundColour(wxSystemSettings::GetColour(wxSYS_COLOUR_WINDOW));
+    _scrollTimer.SetOwner(this);
 }
 
 void wxDataViewCardCtrl::AssociateCardRenderer(wxDataViewCardRenderer* renderer)
@@ -81,6 +87,7 @@ void wxDataViewCardCtrl::AssociateCardRenderer(wxDataViewCardRenderer* renderer)
         if(_renderer) {
             _renderer->IncRef();
         }
+        RecalculateCardSizes();
     }
 }
 
@@ -92,59 +99,92 @@ void wxDataViewCardCtrl::AssociateModel(wxDataViewListModel* model)
             _model->DecRef();
         }
         _model = model;
+        _indexModel = dynamic_cast<wxDataViewIndexListModel*>(model);
+        _virtualModel = dynamic_cast<wxDataViewVirtualListModel*>(model);
         if(_model) {
             _model->IncRef();
             _model->AddNotifier(this);
         }
+        RecalculateCardSizes();
     }
 }
 
 void wxDataViewCardCtrl::OnPaint(wxPaintEvent& event)
 {
+    TraceScope trace("wxDataViewCardCtrl::OnPaint");
     wxSize clientSize = GetClientSize();
 
+    // Only the area to repaint is drawn: the exposed strip when scrolling, what was shifted being kept.
+    wxRect updateRect = GetUpdateRegion().GetBox();
+
     wxAutoBufferedPaintDC dc(this);
     dc.SetBrush(wxBrush(GetBackgroundColour()));
     dc.SetPen(*wxTRANSPARENT_PEN);
-    dc.DrawRectangle(wxPoint(0, 0), clientSize);
+    dc.DrawRectangle(updateRect);
 
     wxDataViewListModel* model = GetModel();
-    if(model)
+    unsigned int count = GetCardCount();
+    if(model && _renderer && count > 0)
     {
-        wxDataViewItemArray children;
-        wxDataViewItem root;
-        unsigned int count = model->GetChildren(root, children);
-
-        wxPoint pos{_marginSize.GetWidth(), _marginSize.GetHeight()};;
-
-        int cardPerRow = (clientSize.GetWidth()-_marginSize.GetWidth()) / (_maxSize.GetWidth()+_marginSize.GetWidth());
-        if(cardPerRow <= 0) {
-            cardPerRow = 1; // At least one card per row
-        }
-        int firstCard = GetScrollPos(wxVERTICAL) * cardPerRow;
+        // Rows intersecting the area to repaint, computed from the layout.
+        int cardPerRow = GetCardsPerRow(clientSize.GetWidth());
+        int columnWidth = _maxSize.GetWidth() + _marginSize.GetWidth();
+        int rowHeight = GetRowHeight();
+        int firstVisibleRow = std::max(0, (updateRect.GetTop() + _scrollY - _marginSize.GetHeight()) / rowHeight);
+        int lastVisibleRow = std::max(0, (updateRect.GetBottom() + _scrollY - _marginSize.GetHeight()) / rowHeight);
+
+        unsigned int first = std::min<size_t>(count, (size_t) firstVisibleRow * cardPerRow);
+        unsigned int last = std::min<size_t>(count, (size_t) (lastVisibleRow + 1) * cardPerRow);
+        wxDataViewItemArray items;
+        GetCardItems(first, last, items);
 
-        for(unsigned int i = firstCard; i < count; ++i)
+        for(unsigned int i = first; i < first + items.size(); ++i)
         {
-            wxDataViewItem item = children[i];
+            wxPoint pos{_marginSize.GetWidth() + (int) (i % cardPerRow) * columnWidth,
+                        _marginSize.GetHeight() + (int) (i / cardPerRow) * rowHeight - _scrollY};
             dc.SetClippingRegion(pos, _maxSize);
-            _renderer->DrawCard(*model, item, dc, pos, _maxSize);
+            _renderer->DrawCard(*model, items[i - first], dc, pos, _maxSize);
             dc.DestroyClippingRegion();
-            pos.x += _maxSize.GetWidth() + _marginSize.GetWidth();
-
-            if(pos.x + _maxSize.GetWidth() + _marginSize.GetWidth() > clientSize.GetWidth()) {
-                // If next card would overflow, move to next row
-                pos.x = _marginSize.GetWidth();
-                pos.y += _maxSize.GetHeight() + _marginSize.GetHeight();
-            }
-
-            if(pos.y >= clientSize.GetHeight()) {
-                // If next card would overflow vertically, stop drawing
-                break;
-            }
         }
     }
 }
 
+unsigned int wxDataViewCardCtrl::GetCardCount() const
+{
+    return _model ? _model->GetCount() : 0;
+}
+
+void wxDataViewCardCtrl::GetCardItems(unsigned int first, unsigned int last, wxDataViewItemArray& items) const
+{
+    items.clear();
+    if(_indexModel) {
+        for(unsigned int row = first; row < last; ++row) {
+            items.push_back(_indexModel->GetItem(row));
+        }
+    } else if(_virtualModel) {
+        for(unsigned int row = first; row < last; ++row) {
+            items.push_back(_virtualModel->GetItem(row));
+        }
+    } else if(_model) {
+        // Other list models can only enumerate all their items.
+        wxDataViewItemArray children;
+        _model->GetChildren(wxDataViewItem(), children);
+        last = std::min<unsigned int>(last, children.size());
+        for(unsigned int row = first; row < last; ++row) {
+            items.push_back(children[row]);
+        }
+    }
+}
+
+int wxDataViewCardCtrl::GetCardsPerRow(int clientWidth) const
+{
+    int cardPerRow = (clientWidth - _marginSize.GetWidth()) / (_maxSize.GetWidth() + _marginSize.GetWidth());
+    if(cardPerRow <= 0) {
+        cardPerRow = 1; // At least one card per row
+    }
+    return cardPerRow;
+}
+
 void wxDataViewCardCtrl::OnSize(wxSizeEvent& event)
 {
     UpdateScrollbars();
@@ -153,8 +193,97 @@ void wxDataViewCardCtrl::OnSize(wxSizeEvent& event)
 
 void wxDataViewCardCtrl::OnScroll(wxScrollWinEvent& event)
 {
-    UpdateScrollbars();
-    Refresh();
+    if(event.GetOrientation() != wxVERTICAL) {
+        event.Skip();
+        return;
+    }
+
+    wxEventType type = event.GetEventType();
+    int position;
+    if(type == wxEVT_SCROLLWIN_TOP) {
+        position = 0;
+    } else if(type == wxEVT_SCROLLWIN_BOTTOM) {
+        position = GetMaxScrollPosition();
+    } else if(type == wxEVT_SCROLLWIN_LINEUP) {
+        position = _scrollY - GetRowHeight();
+    } else if(type == wxEVT_SCROLLWIN_LINEDOWN) {
+        position = _scrollY + GetRowHeight();
+    } else if(type == wxEVT_SCROLLWIN_PAGEUP) {
+        position = _scrollY - GetClientSize().y;
+    } else if(type == wxEVT_SCROLLWIN_PAGEDOWN) {
+        position = _scrollY + GetClientSize().y;
+    } else {
+        position = event.GetPosition(); // Thumb track and release
+    }
+
+    // The scrollbar takes over any wheel scrolling in progress.
+    _scrollTimer.Stop();
+    ScrollToPosition(position);
+    _scrollTarget = _scrollY;
+}
+
+void wxDataViewCardCtrl::OnMouseWheel(wxMouseEvent& event)
+{
+    if(event.GetWheelAxis() != wxMOUSE_WHEEL_VERTICAL) {
+        event.Skip();
+        return;
+    }
+
+    // A notch scrolls a row, or a page. High resolution wheels and touchpads send fractions of notches.
+    double step = event.IsPageScroll() ? GetClientSize().y : GetRowHeight();
+    _wheelRemainder -= step * event.GetWheelRotation() / event.GetWheelDelta();
+    int pixels = (int) _wheelRemainder;
+    _wheelRemainder -= pixels;
+    if(pixels == 0) {
+        return;
+    }
+
+    _scrollTarget = std::clamp(_scrollTarget + pixels, 0, GetMaxScrollPosition());
+    if(!_scrollTimer.IsRunning()) {
+        _scrollTimer.Start(SCROLL_FRAME_MS);
+    }
+}
+
+void wxDataViewCardCtrl::OnScrollTimer(wxTimerEvent& event)
+{
+    // Ease out: a third of the remaining distance per frame, the last pixels at once.
+    int remaining = _scrollTarget - _scrollY;
+    int step = remaining / 3;
+    ScrollToPosition(_scrollY + (step != 0 ? step : remaining));
+    if(_scrollY == _scrollTarget) {
+        _scrollTimer.Stop();
+    }
+}
+
+void wxDataViewCardCtrl::ScrollToPosition(int y)
+{
+    y = std::clamp(y, 0, GetMaxScrollPosition());
+    int delta = _scrollY - y;
+    if(delta == 0) {
+        return;
+    }
+    _scrollY = y;
+    SetScrollPos(wxVERTICAL, _scrollY);
+
+    if(std::abs(delta) >= GetClientSize().y) {
+        Refresh(); // Nothing drawn remains visible
+    } else {
+        ScrollWindow(0, delta);
+    }
+}
+
+int wxDataViewCardCtrl::GetRowHeight() const
+{
+    return _maxSize.GetHeight() + _marginSize.GetHeight();
+}
+
+int wxDataViewCardCtrl::GetMaxScrollPosition() const
+{
+    wxSize clientSize = GetClientSize();
+    int cardPerRow = GetCardsPerRow(clientSize.x);
+    int lineCount = (GetCardCount() + cardPerRow - 1) / cardPerRow;
+    int contentHeight = _marginSize.GetHeight() + lineCount * GetRowHeight();
+    return std::max(0, contentHeight - clientSize.y);
 }
 
 bool wxDataViewCardCtrl::ItemAdded( const wxDataViewItem &parent, const wxDataViewItem &item )
@@ -166,8 +295,8 @@ bool wxDataViewCardCtrl::ItemAdded( const wxDataViewItem &parent, const wxDataVi
 
 bool wxDataViewCardCtrl::ItemDeleted( const wxDataViewItem &parent, const wxDataViewItem &item )
 {
-    _cardSizes.erase(item.GetID());
-    RecalculateMaxSize();
+    RemoveCardSize(item);
+    UpdateMaxSize();
     UpdateScrollbars();
     return true;
 }
@@ -189,9 +318,9 @@ bool wxDataViewCardCtrl::ItemsAdded( const wxDataViewItem &parent, const wxDataV
 bool wxDataViewCardCtrl::ItemsDeleted( const wxDataViewItem &parent, const wxDataViewItemArray &items )
 {
     for(const auto& item : items) {
-        _cardSizes.erase(item.GetID());
+        RemoveCardSize(item);
     }
-    RecalculateMaxSize();
+    UpdateMaxSize();
     UpdateScrollbars();
     return true;
 }
@@ -212,8 +341,8 @@ bool wxDataViewCardCtrl::ValueChanged( const wxDataViewItem &item, unsigned int
 
 bool wxDataViewCardCtrl::Cleared()
 {
-    _cardSizes.clear();
-    RecalculateMaxSize();
+    // Also called when the model is reset with new items.
+    RecalculateCardSizes();
     UpdateScrollbars();
     return true;
 }
@@ -225,72 +354,92 @@ void wxDataViewCardCtrl::Resort()
 
 void wxDataViewCardCtrl::ComputeCardSize(const wxDataViewItem &item)
 {
-    wxClientDC dc(this);
-    if(_model && _renderer) {
-        wxSize size = _renderer->GetCardSize(*_model, item, dc);
-        _cardSizes[item.GetID()] = size;
-        if(size.GetWidth() > _maxSize.GetWidth()) {
-            _maxSize.SetWidth(size.GetWidth());
-        }
-        if(size.GetHeight() > _maxSize.GetHeight()) {
-            _maxSize.SetHeight(size.GetHeight());
-        }
+    TraceScope trace("wxDataViewCardCtrl::ComputeCardSize");
+    if(_model && _renderer && !HasUniformCardSize()) {
+        wxClientDC dc(this);
+        SetCardSize(item, _renderer->GetCardSize(*_model, item, dc));
+        UpdateMaxSize();
     }
 }
 
 void wxDataViewCardCtrl::ComputeCardSizes(const wxDataViewItemArray &items)
 {
-    wxClientDC dc(this);
-    if(_model && _renderer) {
+    TraceScope trace("wxDataViewCardCtrl::ComputeCardSizes");
+    if(_model && _renderer && !HasUniformCardSize()) {
+        wxClientDC dc(this);
         for(const auto& item : items) {
-            wxSize size = _renderer->GetCardSize(*_model, item, dc);
-            _cardSizes[item.GetID()] = size;
-            if(size.GetWidth() > _maxSize.GetWidth()) {
-                _maxSize.SetWidth(size.GetWidth());
-            }
-            if(size.GetHeight() > _maxSize.GetHeight()) {
-                _maxSize.SetHeight(size.GetHeight());
-            }
+            SetCardSize(item, _renderer->GetCardSize(*_model, item, dc));
         }
+        UpdateMaxSize();
     }
 }
 
-void wxDataViewCardCtrl::RecalculateMaxSize()
+void wxDataViewCardCtrl::RecalculateCardSizes()
 {
-    _maxSize = {0, 0};
-    if(_model) {
+    _cardSizes.clear();
+    _cardWidths.clear();
+    _cardHeights.clear();
+    if(_model && _renderer && !HasUniformCardSize()) {
         wxDataViewItemArray items;
         _model->GetChildren(wxDataViewItem(), items);
         ComputeCardSizes(items);
     }
+    UpdateMaxSize();
 }
 
-void wxDataViewCardCtrl::UpdateScrollbars()
+void wxDataViewCardCtrl::SetCardSize(const wxDataViewItem &item, const wxSize& size)
 {
-    int oldPos = GetScrollPos(wxVERTICAL);
-    wxSize clientSize = GetClientSize();
-
-    if(_cardSizes.empty() || clientSize.x <= 0 || clientSize.y <= 0) {
-        SetScrollbar(wxVERTICAL, 0, 1, 1);
-        return;
+    auto [it, inserted] = _cardSizes.try_emplace(item.GetID(), size);
+    if(!inserted) {
+        _cardWidths.erase(_cardWidths.find(it->second.GetWidth()));
+        _cardHeights.erase(_cardHeights.find(it->second.GetHeight()));
+        it->second = size;
     }
+    _cardWidths.insert(size.GetWidth());
+    _cardHeights.insert(size.GetHeight());
+}
 
-    clientSize -= _marginSize;
-    int cardPerRow = clientSize.x / (_maxSize.GetWidth() + _marginSize.GetWidth());
-    if(cardPerRow <= 0) {
-        cardPerRow = 1; // At least one card per row
+void wxDataViewCardCtrl::RemoveCardSize(const wxDataViewItem &item)
+{
+    auto it = _cardSizes.find(item.GetID());
+    if(it != _cardSizes.end()) {
+        _cardWidths.erase(_cardWidths.find(it->second.GetWidth()));
+        _cardHeights.erase(_cardHeights.find(it->second.GetHeight()));
+        _cardSizes.erase(it);
     }
-    int lineCount = _cardSizes.size() / cardPerRow;
-    if(_cardSizes.size() % cardPerRow != 0) {
-        lineCount++; // Add one more line if there are remaining cards
+}
+
+void wxDataViewCardCtrl::UpdateMaxSize()
+{
+    if(HasUniformCardSize()) {
+        _maxSize = _renderer->GetUniformCardSize();
+    } else {
+        _maxSize.SetWidth(_cardWidths.empty() ? 0 : *_cardWidths.rbegin());
+        _maxSize.SetHeight(_cardHeights.empty() ? 0 : *_cardHeights.rbegin());
     }
+}
 
-    int cardPerColumn = clientSize.y / (_maxSize.GetHeight() + _marginSize.GetHeight());
+bool wxDataViewCardCtrl::HasUniformCardSize() const
+{
+    if(_renderer == nullptr) return false;
+    wxSize size = _renderer->GetUniformCardSize();
+    return size.GetWidth() > 0 && size.GetHeight() > 0;
+}
+
+void wxDataViewCardCtrl::UpdateScrollbars()
+{
+    wxSize clientSize = GetClientSize();
 
-    if(oldPos > lineCount) {
-        oldPos = lineCount; // Clamp old position to max lines
+    unsigned int count = GetCardCount();
+    if(count == 0 || clientSize.x <= 0 || clientSize.y <= 0) {
+        _scrollY = _scrollTarget = 0;
+        SetScrollbar(wxVERTICAL, 0, 1, 1);
+        return;
     }
 
-    SetScrollbar(wxVERTICAL, oldPos, cardPerColumn, lineCount);
+    // In pixels, the thumb being the visible height. Contents may have shrunk below the current position.
+    int maxPosition = GetMaxScrollPosition();
+    _scrollY = std::min(_scrollY, maxPosition);
+    _scrollTarget = std::min(_scrollTarget, maxPosition);
+    SetScrollbar(wxVERTICAL, _scrollY, clientSize.y, maxPosition + clientSize.y);
 }
-
@@ -28,7 +28,9 @@
 
 #include <wx/dataview.h>
 #include <wx/control.h>
+#include <wx/timer.h>
 #include <map>
+#include <set>
 
 class wxDataViewCardRenderer : public wxRefCounter
 {
@@ -39,6 +41,12 @@ public:
     virtual wxSize GetCardSize(const wxDataViewListModel& model, const wxDataViewItem& item, const wxDC& dc) const =0;
     virtual void DrawCard(const wxDataViewListModel& model, const wxDataViewItem& item, wxDC& dc, const wxPoint& pos, const wxSize& size) const =0;
 
+    /**
+     * Size of all the cards, for renderers drawing them at a fixed size: cards are then never measured
+     * with GetCardSize(). Returns wxDefaultSize (default) to measure each card.
+     */
+    virtual wxSize GetUniformCardSize() const { return wxDefaultSize; }
+
     virtual size_t GetFieldCount() const =0;
 };
 
@@ -65,24 +73,53 @@ public:
 
     wxDataViewListModel* GetModel() const { return _model; }
 
+    /** Number of cards, from the model row count. */
+    unsigned int GetCardCount() const;
+
 protected:
     wxDataViewListModel* _model = nullptr;
+    // The model when it can give items by row, so painting does not enumerate all of them.
+    wxDataViewIndexListModel* _indexModel = nullptr;
+    wxDataViewVirtualListModel* _virtualModel = nullptr;
     wxDataViewCardRenderer* _renderer = nullptr;
 
+    // Measured size of each card, with all the widths and heights to keep the largest ones up to date.
     std::map<void*, wxSize> _cardSizes;
+    std::multiset<int> _cardWidths;
+    std::multiset<int> _cardHeights;
     wxSize _maxSize;
     wxSize _marginSize {8, 8};
 
+    // Scrolling is pixel granular. Wheel scrolling eases to its target, one step per frame.
+    static constexpr int SCROLL_FRAME_MS = 16;
+    int _scrollY = 0;
+    int _scrollTarget = 0;
+    double _wheelRemainder = 0;
+    wxTimer _scrollTimer;
+
     void ComputeCardSize(const wxDataViewItem &item);
     void ComputeCardSizes(const wxDataViewItemArray &items);
-    void RecalculateMaxSize();
+    void RecalculateCardSizes();
+    void SetCardSize(const wxDataViewItem &item, const wxSize& size);
+    void RemoveCardSize(const wxDataViewItem &item);
+    void UpdateMaxSize();
+    bool HasUniformCardSize() const;
     void UpdateScrollbars();
+    int GetCardsPerRow(int clientWidth) const;
+    int GetRowHeight() const;
+    int GetMaxScrollPosition() const;
+    /** Move the view to the position, shifting what is already drawn and only repainting the exposed strip. */
+    void ScrollToPosition(int y);
+    /** Items of the cards in [first, last), fewer when the model has fewer children than its count. */
+    void GetCardItems(unsigned int first, unsigned int last, wxDataViewItemArray& items) const;
 
     void CommonInit();
 
     void OnPaint(wxPaintEvent& event);
     void OnSize(wxSizeEvent& event);
     void OnScroll(wxScrollWinEvent& event);
+    void OnMouseWheel(wxMouseEvent& event);
+    void OnScrollTimer(wxTimerEvent& event);
 
     bool ItemAdded( const wxDataViewItem &parent, const wxDataViewItem &item ) override;
     bool ItemDeleted( const wxDataViewItem &parent, const wxDataViewItem &item ) override;
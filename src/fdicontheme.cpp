@@ -21,121 +21,688 @@
  * SOFTWARE.
 */
 #include "fdicontheme.h"
+#include "cacheutil.h"
+#include "gtkiconcache.h"
+#include "iconbundle.h"
+#include "indextheme.h"
+#include "trace.h"
 
 #include <wx/dir.h>
 #include <wx/log.h>
 #include <wx/filename.h>
-#include <wx/wfstream.h>
-#include <wx/tokenzr.h>
 #include <wx/filefn.h>
+#include <wx/utils.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
 #include <filesystem>
+#include <thread>
+
+namespace {
+
+time_t GetModificationTime(const wxString& path) {
+    wxStructStat st;
+    if (wxStat(path, &st) != 0) return 0;
+    return st.st_mtime;
+}
+
+typedef std::chrono::steady_clock Clock;
+
+uint64_t MicrosecondsSince(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+}
+
+// GTK cache suffix flag of each IconIndex::Extension
+const uint16_t SUFFIX_FLAGS[IconIndex::EXT_COUNT] = {
+    GtkIconCache::HAS_SUFFIX_PNG, GtkIconCache::HAS_SUFFIX_SVG, GtkIconCache::HAS_SUFFIX_XPM
+};
+
+// Threads shared by every ParallelFor() call, one per core.
+WorkerPool& ParallelPool() {
+    static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    return pool;
+}
+
+// Call fn(i) for i in [0, count) from up to threadCount threads, including the calling one.
+// threadCount 0 means one per core.
+// The caller only waits for the indices other threads already took, so helpers still queued behind
+// the caller's own work, as in nested calls from pool threads, never block it.
+template<typename Fn>
+void ParallelFor(size_t count, unsigned int threadCount, Fn&& fn) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threadCount = std::min<size_t>(threadCount, count);
+    if (threadCount <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    // Shared with the helpers, which may only start once the call has returned.
+    struct State {
+        std::atomic<size_t> next{0};
+        size_t done = 0;
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+    auto state = std::make_shared<State>();
+    auto work = [count, &fn](State& state) {
+        size_t finished = 0;
+        for (size_t i = state.next++; i < count; i = state.next++) {
+            fn(i);
+            ++finished;
+        }
+        if (finished == 0) return;
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.done += finished;
+        if (state.done == count) state.condition.notify_all();
+    };
+    for (unsigned int t = 1; t < threadCount; ++t) {
+        // fn is only used while indices are left, the caller waiting for them.
+        ParallelPool().Submit([state, work]() { work(*state); });
+    }
+    work(*state);
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->condition.wait(lock, [&]() { return state->done == count; });
+}
+
+// wxBitmap creation, to do on the main thread
+std::optional<wxBitmapBundle> MakeBundle(const wxVector<wxImage>& images) {
+    wxVector<wxBitmap> bitmaps;
+    for (const auto& image : images) {
+        if (image.IsOk())
+            bitmaps.push_back(wxBitmap(image));
+    }
+
+    if (bitmaps.empty()) return std::nullopt;
+
+    return wxBitmapBundle::FromBitmaps(bitmaps);
+}
+
+} // namespace
+
+//
+// IconDirectory
+//
+
+bool IconDirectory::MatchesSize(int iconSize, int iconScale) const {
+    if (scale != iconScale) return false;
+    switch (type) {
+        case FIXED:    return size == iconSize;
+        case SCALABLE: return minSize <= iconSize && iconSize <= maxSize;
+        default:       return size - threshold <= iconSize && iconSize <= size + threshold;
+    }
+}
+
+int IconDirectory::SizeDistance(int iconSize, int iconScale) const {
+    int pixels = iconSize * iconScale;
+    int low, high;
+    switch (type) {
+        case FIXED:
+            return std::abs(size * scale - pixels);
+        case SCALABLE:
+            low = minSize * scale;
+            high = maxSize * scale;
+            break;
+        default:
+            // The specification pseudo-code has typos here, this is the intended behavior.
+            low = (size - threshold) * scale;
+            high = (size + threshold) * scale;
+            break;
+    }
+    if (pixels < low) return low - pixels;
+    if (pixels > high) return pixels - high;
+    return 0;
+}
 
 //
 // IconTheme
 //
 
 
-IconTheme::IconTheme(const wxString& themePath) : path(themePath) {}
+IconTheme::IconTheme(const wxString& themePath) : path(themePath), indexCacheDir(GetDefaultIndexCacheDirectory()) {}
+
+wxString IconTheme::GetDefaultIndexCacheDirectory() {
+    return GetUserCacheDirectory();
+}
+
+bool IconTheme::Discover() {
+    // Only read the [Icon Theme] group, which comes first in practice.
+    IndexThemeFile index;
+    if (!index.Load(wxFileName(path, "index.theme").GetFullPath(), "Icon Theme")) return false;
+    if (!index.GetValue("Icon Theme", "Directories")) return false;
+
+    name = index.GetString("Icon Theme", "Name");
+    if (name.IsEmpty()) {
+        name = path.AfterLast(wxFileName::GetPathSeparator());
+    }
+    return true;
+}
 
 bool IconTheme::Preload() {
-    wxFileName indexFile(path, "index.theme");
-    if (!indexFile.FileExists()) return false;
+    TraceScope trace("IconTheme::Preload");
+    return Load();
+}
 
-    wxFileInputStream input(indexFile.GetFullPath());
-    if (!input.IsOk()) return false;
+bool IconTheme::Load() const {
+    std::call_once(loadOnce, [this]() {
+        TraceScope trace("IconTheme::Parse");
+        auto start = Clock::now();
+        valid = Parse();
+        // Slots filled on demand, sized whatever the outcome: a theme failing to parse has no directory.
+        listings = std::vector<std::atomic<Listing>>(directories.size());
+        sizeLookups = std::vector<std::atomic<std::shared_ptr<const SizeLookup>>>(MAX_CACHED_SIZE * MAX_CACHED_SCALE);
+        counters.preloadTime += MicrosecondsSince(start);
+        loaded = true;
+    });
+    return valid;
+}
 
-    wxFileConfig config(input);
+bool IconTheme::Parse() const {
+    IndexThemeFile index;
+    if (!index.Load(wxFileName(path, "index.theme").GetFullPath())) return false;
 
-    wxString dirList;
-    if (!config.Read("Icon Theme/Directories", &dirList)) return false;
-    name = config.Read("Icon Theme/Name", path.AfterLast(wxFileName::GetPathSeparator()));
+    auto dirList = index.GetValue("Icon Theme", "Directories");
+    if (!dirList) return false;
+    if (name.IsEmpty()) {
+        name = index.GetString("Icon Theme", "Name", path.AfterLast(wxFileName::GetPathSeparator()));
+    }
 
-    wxString inheritsStr;
-    if (config.Read("Icon Theme/Inherits", &inheritsStr)) {
-        wxStringTokenizer tk(inheritsStr, ",");
-        while (tk.HasMoreTokens()) {
-            inherits.push_back(tk.GetNextToken().Trim().Trim(false));
+    if (auto inheritList = index.GetValue("Icon Theme", "Inherits")) {
+        for (auto parent : IndexThemeFile::SplitList(*inheritList)) {
+            inherits.push_back(wxString::FromUTF8(parent.data(), parent.size()));
         }
     }
 
-    wxStringTokenizer dirs(dirList, ",");
-    while (dirs.HasMoreTokens()) {
-        wxString dirName = dirs.GetNextToken().Trim().Trim(false);
-        wxString section = dirName;
-        if (!config.HasGroup(section)) continue;
+    for (auto section : IndexThemeFile::SplitList(*dirList)) {
+        if (!index.HasGroup(section)) continue;
 
-        config.SetPath("/" + section);
         IconDirectory dir;
-        dir.path = wxFileName(path + "/" + section , "").GetFullPath();
-        config.Read("Size", &dir.size);
-        config.Read("MinSize", &dir.minSize);
-        config.Read("MaxSize", &dir.maxSize);
-        config.Read("Type", &dir.type);
+        dir.name = wxString::FromUTF8(section.data(), section.size());
+        dir.path = wxFileName(path + "/" + dir.name, "").GetFullPath();
+        dir.size = index.GetInt(section, "Size", 0);
+        dir.minSize = index.GetInt(section, "MinSize", dir.size);
+        dir.maxSize = index.GetInt(section, "MaxSize", dir.size);
+        dir.threshold = index.GetInt(section, "Threshold", 2);
+        dir.scale = index.GetInt(section, "Scale", 1);
+        auto type = index.GetValue(section, "Type");
+        if (type == "Fixed") {
+            dir.type = IconDirectory::FIXED;
+        } else if (type == "Scalable") {
+            dir.type = IconDirectory::SCALABLE;
+        }
         directories.push_back(dir);
-        config.SetPath("/");
     }
-
     return true;
 }
 
-void IconTheme::BuildCache(bool force) const {
-    if(iconCache.size()==0 || force) {
-        iconCache.clear();
-        for (const auto& dir : directories) {
-            wxDir directory(dir.path);
-            if (!directory.IsOpened()) continue;
+wxVector<IconTheme::ListedIcon> IconTheme::ScanDirectory(size_t dirIndex) const {
+    ++counters.directoriesScanned;
+    wxVector<ListedIcon> icons;
+    wxDir directory(directories[dirIndex].path);
+    if (!directory.IsOpened()) return icons;
+
+    wxString file;
+    ListedIcon icon;
+    bool cont = directory.GetFirst(&file, wxEmptyString, wxDIR_FILES);
+    while (cont) {
+        if (IconIndex::ParseFileName(file, icon.name, icon.extension)) {
+            icons.push_back(icon);
+        }
+        cont = directory.GetNext(&file);
+    }
+    std::sort(icons.begin(), icons.end());
+    counters.filesIndexed += icons.size();
+    return icons;
+}
+
+std::shared_ptr<const IconTheme::Index> IconTheme::GetIndex(bool build) const {
+    auto current = index.load();
+    if (current || (!build && cachesProbed)) return current;
+
+    EnsureLoaded();
+    std::lock_guard<std::mutex> lock(buildMutex);
+    current = index.load();
+    if (current) return current;
+
+    if (!valid) {
+        // index.theme changed or vanished since discovery: nothing to look up, nor to cache.
+        current = MakeIndex({});
+        index = current;
+        cachesProbed = true;
+        return current;
+    }
+
+    // Timed from here, waiting for another builder is not building.
+    TraceScope trace("IconTheme::BuildIndex");
+    auto start = Clock::now();
+    if (!cachesProbed) {
+        current = ProbeCaches();
+        if (current) {
+            index = current;
+            ++counters.cacheLoads;
+        }
+        cachesProbed = true;
+    }
+    if (!current && build) {
+        current = ScanIndex();
+        index = current;
+        ++counters.indexBuilds;
+
+        // Lookups go through the index from now on.
+        for (auto& listing : listings) {
+            listing.store(nullptr);
+        }
+    }
+    counters.indexBuildTime += MicrosecondsSince(start);
+    return current;
+}
+
+std::shared_ptr<const IconTheme::Index> IconTheme::ProbeCaches() const {
+    auto cached = LoadGtkCache(wxFileName(path, "icon-theme.cache").GetFullPath());
+    if (!cached) {
+        wxString indexCacheFile = GetIndexCacheFile();
+        if (!indexCacheFile.IsEmpty()) {
+            cached = LoadGtkCache(indexCacheFile, true);
+        }
+    }
+    return cached;
+}
+
+std::shared_ptr<const IconTheme::Index> IconTheme::ScanIndex() const {
+    TraceScope trace("IconTheme::ScanIndex");
+    time_t unset = 0;
+    scanTime.compare_exchange_strong(unset, time(nullptr));
+
+    // Scan the remaining directories, each one into its own slot so the merge below keeps directory order.
+    std::vector<Listing> dirListings(directories.size());
+    ParallelFor(directories.size(), buildThreads, [&](size_t i) {
+        dirListings[i] = GetListing(i);
+    });
+
+    auto scanned = MakeIndex(dirListings);
+    if (!indexCacheDir.IsEmpty()) {
+        WriteIndexCache(dirListings, scanTime);
+    }
+    return scanned;
+}
+
+std::shared_ptr<const IconTheme::Index> IconTheme::MakeIndex(const std::vector<Listing>& dirListings) {
+    auto made = std::make_shared<Index>();
+    for (size_t i = 0; i < dirListings.size(); ++i) {
+        for (const auto& icon : *dirListings[i]) {
+            made->iconIndex.Add(icon.name, i, icon.extension);
+        }
+    }
+    made->iconIndex.Finish();
+    return made;
+}
+
+std::vector<IconTheme::Listing> IconTheme::GetIndexListings(const Index& from) const {
+    std::vector<wxVector<ListedIcon>> icons(directories.size());
+    if (from.gtkCache) {
+        from.gtkCache->ForEachIcon([&](const char* iconName, const GtkIconCache::ImageList& images) {
+            for (uint32_t i = 0; i < images.GetCount(); ++i) {
+                auto image = images[i];
+                if (image.directory >= from.gtkCacheDirectories.size() || from.gtkCacheDirectories[image.directory] < 0) continue;
+                for (int ext = 0; ext < IconIndex::EXT_COUNT; ++ext) {
+                    if (image.flags & SUFFIX_FLAGS[ext]) {
+                        icons[from.gtkCacheDirectories[image.directory]].push_back({wxString::FromUTF8(iconName), (IconIndex::Extension) ext});
+                    }
+                }
+            }
+        });
+    } else {
+        for (uint32_t icon = 0; icon < from.iconIndex.GetIconCount(); ++icon) {
+            wxString iconName = wxString::FromUTF8(from.iconIndex.GetName(icon));
+            for (const auto& entry : from.iconIndex.GetEntries(icon)) {
+                icons[entry.directory].push_back({iconName, entry.extension});
+            }
+        }
+    }
+
+    std::vector<Listing> dirListings;
+    for (auto& dirIcons : icons) {
+        std::sort(dirIcons.begin(), dirIcons.end());
+        dirListings.push_back(std::make_shared<const wxVector<ListedIcon>>(std::move(dirIcons)));
+    }
+    return dirListings;
+}
+
+void IconTheme::RefreshDirectory(size_t dirIndex) const {
+    TraceScope trace("IconTheme::RefreshDirectory");
+    if (!loaded || dirIndex >= directories.size()) return;
+
+    std::lock_guard<std::mutex> lock(buildMutex);
+    auto current = index.load();
+    if (!current) {
+        // Not indexed yet, only forget what was scanned on demand.
+        listings[dirIndex].store(nullptr);
+        return;
+    }
+
+    // Only this directory hits the disk, the others are taken back from the current index.
+    time_t since = time(nullptr);
+    auto dirListings = GetIndexListings(*current);
+    dirListings[dirIndex] = std::make_shared<const wxVector<ListedIcon>>(ScanDirectory(dirIndex));
+    index = MakeIndex(dirListings);
+
+    if (!indexCacheDir.IsEmpty()) {
+        WriteIndexCache(dirListings, since);
+    }
+}
+
+IconTheme::Listing IconTheme::GetListing(size_t dirIndex) const {
+    Listing listing = listings[dirIndex];
+    if (!listing) {
+        // Concurrent scans of the same directory are harmless, they find the same names.
+        time_t unset = 0;
+        scanTime.compare_exchange_strong(unset, time(nullptr));
+        listing = std::make_shared<const wxVector<ListedIcon>>(ScanDirectory(dirIndex));
+        listings[dirIndex] = listing;
+    }
+    return listing;
+}
+
+std::shared_ptr<const IconTheme::SizeLookup> IconTheme::GetSizeLookup(int size, int scale) const {
+    std::atomic<std::shared_ptr<const SizeLookup>>* slot = nullptr;
+    if (size >= 1 && size <= MAX_CACHED_SIZE && scale >= 1 && scale <= MAX_CACHED_SCALE) {
+        slot = &sizeLookups[(scale - 1) * MAX_CACHED_SIZE + size - 1];
+        auto cached = slot->load();
+        if (cached) return cached;
+    }
+
+    auto lookup = std::make_shared<SizeLookup>();
+    for (size_t i = 0; i < directories.size(); ++i) {
+        lookup->order.push_back(i);
+    }
+    wxVector<int> distances;
+    wxVector<bool> matches;
+    for (const auto& dir : directories) {
+        distances.push_back(dir.SizeDistance(size, scale));
+        matches.push_back(dir.MatchesSize(size, scale));
+    }
+    std::stable_sort(lookup->order.begin(), lookup->order.end(), [&](uint16_t a, uint16_t b) {
+        if (matches[a] != matches[b]) return (bool) matches[a];
+        return distances[a] < distances[b];
+    });
+    lookup->rank.resize(directories.size());
+    for (size_t i = 0; i < lookup->order.size(); ++i) {
+        lookup->rank[lookup->order[i]] = i;
+    }
+
+    if (slot != nullptr) {
+        *slot = lookup;
+    }
+    return lookup;
+}
+
+std::optional<wxFileName> IconTheme::FindIconLazily(const wxString& iconName, int size, int scale) const {
+    for (uint16_t dirIndex : GetSizeLookup(size, scale)->order) {
+        auto found = FindInListing(*GetListing(dirIndex), dirIndex, iconName);
+        if (found) return found;
+    }
+    return std::nullopt;
+}
+
+std::optional<wxFileName> IconTheme::FindInListing(const wxVector<ListedIcon>& listing, size_t dirIndex, const wxString& iconName) const {
+    // The first file of the icon has the preferred extension.
+    auto it = std::lower_bound(listing.begin(), listing.end(), iconName, [](const ListedIcon& icon, const wxString& name) {
+        return icon.name < name;
+    });
+    if (it != listing.end() && it->name == iconName) {
+        return wxFileName(directories[dirIndex].path, iconName + IconIndex::GetExtension(it->extension));
+    }
+    return std::nullopt;
+}
 
-            wxString file;
-            bool cont = directory.GetFirst(&file, "*.png", wxDIR_FILES);
-            while (cont) {
-                wxFileName full(dir.path, file);
-                wxString iconName = full.GetName();  // sans extension
-                iconCache[iconName][dir.size] = full;
+std::shared_ptr<const IconTheme::Index> IconTheme::LoadGtkCache(const wxString& cacheFile, bool persistent) const {
+    auto cache = GtkIconCache::Open(cacheFile);
+    if (!cache) return nullptr;
 
-                cont = directory.GetNext(&file);
+    // Like GTK, consider the cache stale as soon as the theme or one of its directories is newer than it.
+    time_t cacheTime = cache->GetModificationTime();
+    if (GetModificationTime(path) > cacheTime) return nullptr;
+    for (const auto& dir : directories) {
+        if (GetModificationTime(dir.path) > cacheTime) return nullptr;
+    }
+    // The persistent index also follows index.theme, even edited in place, to list directories added to it.
+    if (persistent && GetModificationTime(wxFileName(path, "index.theme").GetFullPath()) > cacheTime) return nullptr;
+
+    std::map<wxString, int> dirIndexes;
+    for (size_t i = 0; i < directories.size(); ++i) {
+        dirIndexes[directories[i].name] = i;
+    }
+    auto cached = std::make_shared<Index>();
+    std::set<int> listed;
+    for (const auto& cacheDir : cache->GetDirectories()) {
+        auto it = dirIndexes.find(cacheDir);
+        cached->gtkCacheDirectories.push_back(it != dirIndexes.end() ? it->second : -1);
+        if (it != dirIndexes.end()) listed.insert(it->second);
+    }
+    // WriteIndexCache() lists every directory, GTK only the ones with icons.
+    if (persistent && listed.size() < dirIndexes.size()) return nullptr;
+
+    cached->gtkCache = std::move(cache);
+    return cached;
+}
+
+wxString IconTheme::GetIndexCacheFile() const {
+    if (indexCacheDir.IsEmpty()) return wxEmptyString;
+    // One file per theme path. The GTK header only versions the layout, not what this library writes in it.
+    wxString name = wxString::Format("%016llx-v%u.cache", (unsigned long long) HashUtf8(path), INDEX_CACHE_VERSION);
+    return wxFileName(indexCacheDir, name).GetFullPath();
+}
+
+void IconTheme::WriteIndexCache(const std::vector<Listing>& dirListings, time_t since) const {
+    wxVector<wxString> dirNames;
+    std::map<wxString, wxVector<GtkIconCache::Image>> icons;
+    for (size_t i = 0; i < directories.size(); ++i) {
+        dirNames.push_back(directories[i].name);
+        for (const auto& icon : *dirListings[i]) {
+            // One image per directory, with the flags of all its files.
+            auto& images = icons[icon.name];
+            if (images.empty() || images.back().directory != i) {
+                images.push_back({(uint16_t) i, 0});
             }
+            images.back().flags |= SUFFIX_FLAGS[icon.extension];
         }
     }
+
+    wxLogNull noLog;
+    if (!wxFileName::Mkdir(indexCacheDir, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL)) return;
+
+    wxString cacheFile = GetIndexCacheFile();
+    if (!GtkIconCache::Write(cacheFile, dirNames, icons)) return;
+
+    // Date the index from before the scan, so directories changed meanwhile make it stale.
+    wxDateTime modTime((time_t) (since - 1));
+    wxFileName(cacheFile).SetTimes(nullptr, &modTime, nullptr);
 }
 
-std::optional<wxFileName> IconTheme::FindIcon(const wxString& iconName, int size) {
-    BuildCache();
-    if (iconCache.count(iconName)) {
-        const auto& sizeMap = iconCache[iconName];
-        if (sizeMap.count(size)) return sizeMap.at(size);
-        // Approximate match
-        int closest = -1;
-        for (const auto& [sz, _] : sizeMap) {
-            if (closest == -1 || std::abs(sz - size) < std::abs(closest - size))
-                closest = sz;
+template<typename Fn>
+void IconTheme::ForEachEntry(const Index& index, const wxString& iconName, Fn&& fn) {
+    if (index.gtkCache) {
+        // Visit the directories in index.theme order, so later directories win like with a scan.
+        wxVector<IconIndex::Entry> entries;
+        auto images = index.gtkCache->FindImages(iconName.utf8_str());
+        for (uint32_t i = 0; i < images.GetCount(); ++i) {
+            auto image = images[i];
+            if (image.directory >= index.gtkCacheDirectories.size() || index.gtkCacheDirectories[image.directory] < 0) continue;
+            for (int ext = 0; ext < IconIndex::EXT_COUNT; ++ext) {
+                if (image.flags & SUFFIX_FLAGS[ext]) {
+                    entries.push_back({(uint16_t) index.gtkCacheDirectories[image.directory], (IconIndex::Extension) ext});
+                }
+            }
+        }
+        std::stable_sort(entries.begin(), entries.end(), [](const IconIndex::Entry& a, const IconIndex::Entry& b) {
+            return a.directory < b.directory;
+        });
+        for (const auto& entry : entries) {
+            fn(entry);
+        }
+    } else {
+        for (const auto& entry : index.iconIndex.FindEntries(iconName.utf8_str())) {
+            fn(entry);
         }
-        if (closest != -1) return sizeMap.at(closest);
     }
+}
+
+wxFileName IconTheme::GetIconFile(const wxString& iconName, const IconIndex::Entry& entry) const {
+    return wxFileName(directories[entry.directory].path, iconName + IconIndex::GetExtension(entry.extension));
+}
+
+std::optional<wxFileName> IconTheme::FindIcon(const wxString& iconName, int size, int scale) const {
+    TraceScope trace("IconTheme::FindIcon");
+    EnsureLoaded();
+    if (!valid) return std::nullopt;
+    auto current = GetIndex(!lazyScan);
+    auto found = current ? FindInIndex(*current, *GetSizeLookup(size, scale), iconName) : FindIconLazily(iconName, size, scale);
+    ++(found ? counters.iconsFound : counters.iconsMissing);
+    return found;
+}
+
+std::optional<wxFileName> IconTheme::FindInIndex(const Index& from, const SizeLookup& lookup, const wxString& iconName) const {
+    std::optional<IconIndex::Entry> best;
+    ForEachEntry(from, iconName, [&](const IconIndex::Entry& entry) {
+        if (!best || lookup.rank[entry.directory] < lookup.rank[best->directory]) {
+            best = entry;
+        }
+    });
+    if (best) return GetIconFile(iconName, *best);
     return std::nullopt;
 }
 
-std::map<int, wxFileName> IconTheme::FindAllIcons(const wxString& iconName) const {
-    BuildCache();
-    std::map<int, wxFileName> results;
-    auto it = iconCache.find(iconName);
-    if (it != iconCache.end()) {
-        for (const auto& [size, file] : it->second) {
-            results[size] = file;
+size_t IconTheme::FindIcons(std::span<const wxString> iconNames, int size, int scale, wxVector<std::optional<wxFileName>>& results) const {
+    EnsureLoaded();
+    if (!valid) return std::count(results.begin(), results.end(), std::nullopt);
+    auto current = GetIndex(!lazyScan);
+    auto lookup = GetSizeLookup(size, scale);
+    if (current) {
+        size_t searched = 0;
+        size_t missing = 0;
+        for (size_t i = 0; i < iconNames.size(); ++i) {
+            if (results[i]) continue;
+            ++searched;
+            results[i] = FindInIndex(*current, *lookup, iconNames[i]);
+            if (!results[i]) ++missing;
         }
+        counters.iconsFound += searched - missing;
+        counters.iconsMissing += missing;
+        return missing;
     }
+
+    // Lazily, each directory is listed once for all the names still missing.
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < iconNames.size(); ++i) {
+        if (!results[i]) pending.push_back(i);
+    }
+    size_t searched = pending.size();
+    for (uint16_t dirIndex : lookup->order) {
+        if (pending.empty()) break;
+        auto listing = GetListing(dirIndex);
+        std::erase_if(pending, [&](size_t i) {
+            results[i] = FindInListing(*listing, dirIndex, iconNames[i]);
+            return (bool) results[i];
+        });
+    }
+    counters.iconsFound += searched - pending.size();
+    counters.iconsMissing += pending.size();
+    return pending.size();
+}
+
+std::map<int, wxFileName> IconTheme::FindAllIcons(const wxString& iconName) const {
+    auto current = GetIndex(true);
+    std::map<int, wxFileName> results;
+    int previous = -1;
+    ForEachEntry(*current, iconName, [&](const IconIndex::Entry& entry) {
+        // Later directories win, but the preferred extension within a directory.
+        if (entry.directory == previous) return;
+        previous = entry.directory;
+        const auto& dir = directories[entry.directory];
+        results[dir.size * dir.scale] = GetIconFile(iconName, entry);
+    });
     return results;
 }
 
 std::set<wxString> IconTheme::GetIconNames() const {
-    BuildCache();
     std::set<wxString> names;
-    for (const auto& [name, _] : iconCache) {
-        names.insert(name);
+    for (const char* iconName : *GetSortedIconNames()) {
+        names.emplace_hint(names.end(), wxString::FromUTF8(iconName));
     }
     return names;
 }
 
+std::shared_ptr<const std::vector<const char*>> IconTheme::GetSortedIconNames() const {
+    auto current = GetIndex(true);
+    std::call_once(current->sortOnce, [&]() {
+        auto& names = current->sortedNames;
+        if (current->gtkCache) {
+            current->gtkCache->ForEachIcon([&](const char* iconName, const GtkIconCache::ImageList& images) {
+                for (uint32_t i = 0; i < images.GetCount(); ++i) {
+                    auto image = images[i];
+                    if ((image.flags & (GtkIconCache::HAS_SUFFIX_PNG | GtkIconCache::HAS_SUFFIX_SVG | GtkIconCache::HAS_SUFFIX_XPM))
+                            && image.directory < current->gtkCacheDirectories.size()
+                            && current->gtkCacheDirectories[image.directory] >= 0) {
+                        names.push_back(iconName);
+                        break;
+                    }
+                }
+            });
+        } else {
+            for (uint32_t icon = 0; icon < current->iconIndex.GetIconCount(); ++icon) {
+                names.push_back(current->iconIndex.GetName(icon));
+            }
+        }
+        auto less = [](const char* a, const char* b) { return std::strcmp(a, b) < 0; };
+        auto equal = [](const char* a, const char* b) { return std::strcmp(a, b) == 0; };
+        std::sort(names.begin(), names.end(), less);
+        names.erase(std::unique(names.begin(), names.end(), equal), names.end());
+    });
+    // Shares the ownership of the index, which owns the names.
+    return std::shared_ptr<const std::vector<const char*>>(current, &current->sortedNames);
+}
+
+IconThemeStats IconTheme::GetStats() const {
+    IconThemeStats stats;
+    stats.directoriesScanned = counters.directoriesScanned;
+    stats.filesIndexed = counters.filesIndexed;
+    stats.indexBuilds = counters.indexBuilds;
+    stats.cacheLoads = counters.cacheLoads;
+    stats.indexBuildTime = counters.indexBuildTime;
+    stats.preloadTime = counters.preloadTime;
+    stats.iconsFound = counters.iconsFound;
+    stats.iconsMissing = counters.iconsMissing;
+    return stats;
+}
+
+void IconTheme::ResetStats() {
+    counters.directoriesScanned = 0;
+    counters.filesIndexed = 0;
+    counters.indexBuilds = 0;
+    counters.cacheLoads = 0;
+    counters.indexBuildTime = 0;
+    counters.preloadTime = 0;
+    counters.iconsFound = 0;
+    counters.iconsMissing = 0;
+}
+
+IconThemeStats& IconThemeStats::operator+=(const IconThemeStats& other) {
+    directoriesScanned += other.directoriesScanned;
+    filesIndexed += other.filesIndexed;
+    indexBuilds += other.indexBuilds;
+    cacheLoads += other.cacheLoads;
+    indexBuildTime += other.indexBuildTime;
+    preloadTime += other.preloadTime;
+    iconsFound += other.iconsFound;
+    iconsMissing += other.iconsMissing;
+    return *this;
+}
+
 //
 // ThemeDirectoryManager
 //
@@ -154,29 +721,60 @@ const wxVector<wxString>& ThemeDirectoryManager::GetPaths() const {
 // FreeDesktopIconProvider
 //
 
+struct FreeDesktopIconProvider::State {
+    struct ThemeSlot {
+        std::shared_ptr<IconTheme> theme;
+        mutable std::atomic<std::shared_ptr<const IconThemeChain>> chain; // Computed on first use
+        mutable std::atomic<std::shared_ptr<const IconNameIndex>> names;  // Names of the chain, on first search
+    };
+
+    explicit State(size_t lookupCacheCapacity) : lookupCache(lookupCacheCapacity) {}
+
+    wxVector<ThemeDirectory> directories;
+    std::map<wxString, ThemeSlot> themes;
+
+    // The only mutable part, lock-free too.
+    mutable SlotCache<IconLookupKey, std::optional<wxFileName>, IconLookupKeyHash> lookupCache;
+};
+
 FreeDesktopIconProvider::FreeDesktopIconProvider()
 {
+    state = std::make_shared<State>(lookupCacheCapacity);
 }
 
-FreeDesktopIconProvider::FreeDesktopIconProvider(const wxVector<wxString>& paths)
+FreeDesktopIconProvider::FreeDesktopIconProvider(const wxVector<wxString>& paths) : FreeDesktopIconProvider()
 {
     for(const auto& path : paths) {
         AppendPath(path);
     }
 }
 
+std::shared_ptr<FreeDesktopIconProvider::State> FreeDesktopIconProvider::CopyState() const
+{
+    auto current = state.load();
+    auto copy = std::make_shared<State>(lookupCacheCapacity);
+    copy->directories = current->directories;
+    for (const auto& [name, slot] : current->themes) {
+        copy->themes[name].theme = slot.theme;
+    }
+    return copy;
+}
+
 void FreeDesktopIconProvider::Clear()
 {
-    directories.clear();
-    themes.clear();
+    std::lock_guard<std::mutex> lock(writeMutex);
+    state = std::make_shared<State>(lookupCacheCapacity);
 }
 
 void FreeDesktopIconProvider::AppendPath(const wxString& path)
 {
+    std::lock_guard<std::mutex> lock(writeMutex);
     // TODO Ensure the path iis not already in the list
     wxFileName dirPath(path);
     if (wxDirExists(dirPath.GetFullPath())) {
-        directories.push_back(std::move(LoadThemesFromDirectory(dirPath)));
+        auto updated = CopyState();
+        updated->directories.push_back(LoadThemesFromDirectory(dirPath, *updated));
+        state = updated;
     }/* else {
         wxLogWarning("Directory does not exist: %s", dirPath.GetFullPath());
     }*/
@@ -184,10 +782,13 @@ void FreeDesktopIconProvider::AppendPath(const wxString& path)
 
 void FreeDesktopIconProvider::PrependPath(const wxString& path)
 {
+    std::lock_guard<std::mutex> lock(writeMutex);
     // TODO Ensure the path iis not already in the list
     wxFileName dirPath(path);
     if (wxDirExists(dirPath.GetFullPath())) {
-        directories.insert(directories.begin(), std::move(LoadThemesFromDirectory(dirPath)));
+        auto updated = CopyState();
+        updated->directories.insert(updated->directories.begin(), LoadThemesFromDirectory(dirPath, *updated));
+        state = updated;
     }/* else {
         wxLogWarning("Directory does not exist: %s", dirPath.GetFullPath());
     }*/
@@ -195,20 +796,24 @@ void FreeDesktopIconProvider::PrependPath(const wxString& path)
 
 void FreeDesktopIconProvider::RemovePath(const wxString& path)
 {
+    std::lock_guard<std::mutex> lock(writeMutex);
     wxString fullPath = wxFileName(path).GetFullPath();
-    auto it = std::find_if(directories.begin(), directories.end(), [&](const ThemeDirectory& dir)-> bool { return dir.path == fullPath; });
-    if(it!= directories.end()) {
+    auto updated = CopyState();
+    auto it = std::find_if(updated->directories.begin(), updated->directories.end(), [&](const ThemeDirectory& dir)-> bool { return dir.path == fullPath; });
+    if(it!= updated->directories.end()) {
         for(const auto& theme : it->themes) {
-            themes.erase(theme.second); // Remove theme from the main map
+            updated->themes.erase(theme.second); // Remove theme from the main map
         }
-        directories.erase(it);
+        updated->directories.erase(it);
+        state = updated;
     }/* else {
         wxLogWarning("Directory not found: %s", fullPath);
     }*/
 }
 
-ThemeDirectory FreeDesktopIconProvider::LoadThemesFromDirectory(const wxFileName& dirPath)
+ThemeDirectory FreeDesktopIconProvider::LoadThemesFromDirectory(const wxFileName& dirPath, State& themeState) const
 {
+    TraceScope trace("LoadThemesFromDirectory");
     ThemeDirectory themeDir;
     themeDir.path = dirPath.GetFullPath();
 
@@ -217,38 +822,326 @@ ThemeDirectory FreeDesktopIconProvider::LoadThemesFromDirectory(const wxFileName
     bool cont = dir.GetFirst(&sub, wxEmptyString, wxDIR_DIRS);
     while (cont) {
         wxFileName themePath(themeDir.path, sub);
-        IconTheme theme(themePath.GetFullPath());
-        if (theme.Preload()) {
-            themeDir.themes.insert({themePath.GetFullPath(), theme.GetName()});
-            themes.insert({theme.GetName(), std::move(theme)});
+        auto theme = CreateTheme(themePath.GetFullPath());
+        if (theme->Discover()) {
+            themeDir.themes.insert({themePath.GetFullPath(), theme->GetName()});
+            auto [slot, inserted] = themeState.themes.try_emplace(theme->GetName());
+            if (inserted) {
+                slot->second.theme = std::move(theme);
+            }
         }
         cont = dir.GetNext(&sub);
     }
-    return std::move(themeDir);
+    return themeDir;
+}
+
+std::shared_ptr<IconTheme> FreeDesktopIconProvider::CreateTheme(const wxString& themePath) const
+{
+    auto theme = std::make_shared<IconTheme>(themePath);
+    theme->SetIndexCacheDirectory(indexCacheDir);
+    theme->SetLazyScan(lazyScan);
+    theme->SetBuildThreadCount(buildThreads);
+    return theme;
+}
+
+void FreeDesktopIconProvider::ReloadTheme(State& themeState, const wxString& themePath) const
+{
+    for (auto& dir : themeState.directories) {
+        auto it = dir.themes.find(themePath);
+        if (it == dir.themes.end()) continue;
+
+        // Only replace the theme known by this name if it is this one, not a theme of another directory.
+        auto slot = themeState.themes.find(it->second);
+        bool replaced = slot != themeState.themes.end() && slot->second.theme->GetPath() == themePath;
+        if (replaced) {
+            themeState.themes.erase(slot);
+        }
+        dir.themes.erase(it);
+
+        auto theme = CreateTheme(themePath);
+        if (theme->Discover()) {
+            theme->Preload();
+            dir.themes.insert({themePath, theme->GetName()});
+            if (replaced) {
+                auto [added, inserted] = themeState.themes.try_emplace(theme->GetName());
+                if (inserted) {
+                    added->second.theme = std::move(theme);
+                }
+            }
+        }
+        return;
+    }
+}
+
+void FreeDesktopIconProvider::OnThemesChanged(const wxVector<wxString>& changedThemes)
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+    // Even without reloaded theme, the new snapshot drops the lookups resolved against the previous indexes.
+    auto updated = CopyState();
+    for (const auto& themePath : changedThemes) {
+        ReloadTheme(*updated, themePath);
+    }
+    state = updated;
+}
+
+bool FreeDesktopIconProvider::SetWatching(bool watch)
+{
+    if (!watch) {
+        // Released outside of writeMutex, as the watcher thread may be waiting for it.
+        watcher.store(nullptr);
+        return true;
+    }
+    if (watcher.load()) return true;
+
+    auto created = std::make_shared<ThemeWatcher>([this](const wxVector<wxString>& changedThemes) {
+        OnThemesChanged(changedThemes);
+    });
+    if (!created->IsOk()) return false;
+    watcher = created;
+
+    // Themes used later are watched as their chains are computed.
+    for (const auto& [_, slot] : state.load()->themes) {
+        if (slot.theme->IsLoaded()) {
+            created->Watch(slot.theme);
+        }
+    }
+    return true;
+}
+
+bool FreeDesktopIconProvider::IsWatching() const
+{
+    return (bool) watcher.load();
+}
+
+void FreeDesktopIconProvider::SetIndexCacheDirectory(const wxString& dir)
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+    indexCacheDir = dir;
+}
+
+void FreeDesktopIconProvider::SetLazyScan(bool lazy)
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+    lazyScan = lazy;
+}
+
+void FreeDesktopIconProvider::SetBuildThreadCount(unsigned int count)
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+    buildThreads = count;
+}
+
+void FreeDesktopIconProvider::PreloadThemes(unsigned int threadCount)
+{
+    TraceScope trace("PreloadThemes");
+    auto start = Clock::now();
+    auto current = state.load();
+    wxVector<IconTheme*> pending;
+    for (const auto& [_, slot] : current->themes) {
+        if (!slot.theme->IsLoaded()) {
+            pending.push_back(slot.theme.get());
+        }
+    }
+    ParallelFor(pending.size(), threadCount, [&](size_t i) {
+        pending[i]->Preload();
+    });
+    counters.preloadTime += MicrosecondsSince(start);
 }
 
 wxVector<wxString> FreeDesktopIconProvider::GetThemeNames() const {
+    auto current = state.load();
     wxVector<wxString> names;
-    for (const auto& [name, _] : themes) {
+    for (const auto& [name, _] : current->themes) {
         names.push_back(name);
     }
     return names;
 }
 
+void FreeDesktopIconProvider::SetLookupCacheCapacity(size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+    lookupCacheCapacity = capacity;
+    // The cache is sized once, with its snapshot.
+    state = CopyState();
+}
+
+void FreeDesktopIconProvider::ResetLookupCacheStats()
+{
+    lookupHits = 0;
+    lookupMisses = 0;
+}
+
+std::shared_ptr<IconImageCache> FreeDesktopIconProvider::GetImageCache() const
+{
+    return imageCache;
+}
+
+void FreeDesktopIconProvider::SetImageCache(const std::shared_ptr<IconImageCache>& cache)
+{
+    imageCache = cache;
+}
+
+IconLookupCacheStats FreeDesktopIconProvider::GetLookupCacheStats() const
+{
+    auto current = state.load();
+    IconLookupCacheStats stats;
+    stats.hits = lookupHits;
+    stats.misses = lookupMisses;
+    stats.count = current->lookupCache.GetCount();
+    stats.capacity = current->lookupCache.GetCapacity();
+    return stats;
+}
+
+IconProviderStats FreeDesktopIconProvider::GetStats() const
+{
+    IconProviderStats stats;
+    stats.iconsFound = counters.iconsFound;
+    stats.iconsMissing = counters.iconsMissing;
+    stats.fallbacks = counters.fallbacks;
+    stats.fallbackDepth = counters.fallbackDepth;
+    stats.maxFallbackDepth = counters.maxFallbackDepth;
+    stats.preloadTime = counters.preloadTime;
+    stats.lookupCache = GetLookupCacheStats();
+    for (const auto& [_, slot] : state.load()->themes) {
+        stats.themes += slot.theme->GetStats();
+    }
+    auto images = GetImageCache();
+    stats.imagesDecoded = images->GetDecodedCount();
+    stats.bytesDecoded = images->GetDecodedBytes();
+    return stats;
+}
+
+void FreeDesktopIconProvider::ResetStats()
+{
+    counters.iconsFound = 0;
+    counters.iconsMissing = 0;
+    counters.fallbacks = 0;
+    counters.fallbackDepth = 0;
+    counters.maxFallbackDepth = 0;
+    counters.preloadTime = 0;
+    ResetLookupCacheStats();
+    for (const auto& [_, slot] : state.load()->themes) {
+        slot.theme->ResetStats();
+    }
+    GetImageCache()->ResetCounters();
+}
+
+void FreeDesktopIconProvider::CountLookups(bool found, size_t depth, size_t count) const
+{
+    if (count == 0) return;
+    if (!found) {
+        counters.iconsMissing += count;
+        return;
+    }
+    counters.iconsFound += count;
+    if (depth == 0) return;
+
+    counters.fallbacks += count;
+    counters.fallbackDepth += depth * count;
+    size_t max = counters.maxFallbackDepth;
+    while (depth > max && !counters.maxFallbackDepth.compare_exchange_weak(max, depth)) {}
+}
+
+std::shared_ptr<const IconTheme> FreeDesktopIconProvider::FindTheme(const State& themeState, const wxString& themeName)
+{
+    auto it = themeState.themes.find(themeName);
+    if (it != themeState.themes.end()) return it->second.theme;
+
+    // Inherits= refers to theme directory names, which may differ from the display names.
+    for (const auto& dir : themeState.directories) {
+        for (const auto& [themePath, name] : dir.themes) {
+            if (wxFileName(themePath).GetFullName() == themeName) {
+                auto found = themeState.themes.find(name);
+                if (found != themeState.themes.end()) return found->second.theme;
+            }
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<const IconThemeChain> FreeDesktopIconProvider::GetThemeChain(const wxString& themeName) const
+{
+    return GetThemeChain(*state.load(), themeName);
+}
+
+std::shared_ptr<const IconThemeChain> FreeDesktopIconProvider::GetThemeChain(const State& themeState, const wxString& themeName) const
+{
+    auto slot = themeState.themes.find(themeName);
+    if (slot != themeState.themes.end()) {
+        auto cached = slot->second.chain.load();
+        if (cached) return cached;
+    }
+
+    auto chain = std::make_shared<IconThemeChain>();
+    auto root = FindTheme(themeState, themeName);
+    if (root) {
+        auto hicolor = FindTheme(themeState, "hicolor");
+        std::set<const IconTheme*> visited;
+
+        std::function<void(const std::shared_ptr<const IconTheme>&)> visit = [&](const std::shared_ptr<const IconTheme>& theme) {
+            if (!theme || theme == hicolor || !visited.insert(theme.get()).second) return;
+            chain->push_back(theme);
+            for (const auto& parent : theme->GetInherits()) {
+                visit(FindTheme(themeState, parent));
+            }
+        };
+        visit(root);
+
+        if (hicolor) {
+            chain->push_back(hicolor);
+        }
+    }
+
+    // Threads racing here compute the same chain, the last one stored wins.
+    if (slot != themeState.themes.end()) {
+        slot->second.chain = chain;
+    }
+    if (auto current = watcher.load()) {
+        for (const auto& theme : *chain) {
+            current->Watch(theme);
+        }
+    }
+    return chain;
+}
+
 std::set<wxString> FreeDesktopIconProvider::GetIconNames(const wxString& themeName) const
 {
     std::set<wxString> res;
-    auto it = themes.find(themeName);
-    if (it != themes.end())
-    {
-        auto found = it->second.GetIconNames();
-        res.insert(found.begin(), found.end());
-        for (const auto& parent : it->second.GetInherits()) {
-            auto fallback = GetIconNames(parent);
-            res.insert(fallback.begin(), fallback.end());
+    ForEachIconName(themeName, [&](const char* iconName) {
+        res.emplace_hint(res.end(), wxString::FromUTF8(iconName));
+        return true;
+    });
+    return res;
+}
+
+bool FreeDesktopIconProvider::ForEachIconName(const wxString& themeName, const IconNameVisitor& visitor) const
+{
+    // K-way merge of the sorted names of the themes, k being the chain length, small enough for a linear minimum.
+    struct Cursor {
+        std::shared_ptr<const std::vector<const char*>> names;
+        size_t next;
+    };
+    wxVector<Cursor> cursors;
+    for (const auto& theme : *GetThemeChain(themeName)) {
+        cursors.push_back({theme->GetSortedIconNames(), 0});
+    }
+
+    const char* last = nullptr;
+    for (;;) {
+        Cursor* smallest = nullptr;
+        for (auto& cursor : cursors) {
+            if (cursor.next < cursor.names->size() && (smallest == nullptr
+                    || std::strcmp((*cursor.names)[cursor.next], (*smallest->names)[smallest->next]) < 0)) {
+                smallest = &cursor;
+            }
         }
+        if (smallest == nullptr) return true;
+
+        const char* iconName = (*smallest->names)[smallest->next++];
+        if (last != nullptr && std::strcmp(last, iconName) == 0) continue;
+        last = iconName;
+        if (!visitor(iconName)) return false;
     }
-    return res;
 }
 
 std::set<wxString> FreeDesktopIconProvider::GetIconNames() const
@@ -256,63 +1149,154 @@ std::set<wxString> FreeDesktopIconProvider::GetIconNames() const
     return GetIconNames(currentTheme);
 }
 
+wxVector<wxString> FreeDesktopIconProvider::SearchIconNames(const wxString& themeName, const wxString& query, size_t limit) const
+{
+    auto current = state.load();
+    auto slot = current->themes.find(themeName);
+    std::shared_ptr<const IconNameIndex> names;
+    if (slot != current->themes.end()) {
+        names = slot->second.names.load();
+    }
+    if (!names) {
+        wxVector<wxString> chainNames;
+        ForEachIconName(themeName, [&](const char* iconName) {
+            chainNames.push_back(wxString::FromUTF8(iconName));
+            return true;
+        });
+        names = std::make_shared<const IconNameIndex>(std::move(chainNames));
+        if (slot != current->themes.end()) {
+            slot->second.names = names;
+        }
+    }
+    return names->Search(query, limit);
+}
 
 
-std::optional<wxFileName> FreeDesktopIconProvider::FindIcon(const wxString& iconName, int size) {
-    return FindIcon(currentTheme, iconName, size);
-}
 
-std::optional<wxFileName> FreeDesktopIconProvider::FindIcon(const wxString& theme, const wxString& iconName, int size) {
-    auto it = themes.find(theme);
-    if (it == themes.end()) return std::nullopt;
+std::optional<wxFileName> FreeDesktopIconProvider::FindIcon(const wxString& iconName, int size, int scale) const {
+    return FindIcon(currentTheme, iconName, size, scale);
+}
 
-    auto found = it->second.FindIcon(iconName, size);
-    if (found) return found;
+std::optional<wxFileName> FreeDesktopIconProvider::FindIcon(const wxString& theme, const wxString& iconName, int size, int scale) const {
+    TraceScope trace("FindIcon");
+    // Keep the snapshot alive for the whole lookup, whatever happens to the paths meanwhile.
+    auto current = state.load();
+    IconLookupKey key{theme, iconName, size, scale};
+    if (auto cached = current->lookupCache.Find(key)) {
+        ++lookupHits;
+        CountLookups(cached->value.has_value());
+        return cached->value;
+    }
+    if (current->lookupCache.GetCapacity() != 0) {
+        ++lookupMisses;
+    }
 
-    for (const auto& parent : it->second.GetInherits()) {
-        auto fallback = FindIcon(parent, iconName, size);
-        if (fallback) return fallback;
+    std::optional<wxFileName> found;
+    auto chain = GetThemeChain(*current, theme);
+    size_t depth = 0;
+    for (; depth < chain->size(); ++depth) {
+        found = (*chain)[depth]->FindIcon(iconName, size, scale);
+        if (found) break;
     }
+    CountLookups((bool) found, depth);
 
-    return std::nullopt;
+    current->lookupCache.Insert(key, found);
+    return found;
 }
 
-std::optional<wxBitmapBundle> FreeDesktopIconProvider::LoadIconBundle(const wxString& iconName) {
-    std::map<int, wxFileName> foundIcons;
+wxVector<std::optional<wxFileName>> FreeDesktopIconProvider::FindIcons(const wxString& theme, std::span<const wxString> iconNames, int size, int scale) const {
+    TraceScope trace("FindIcons");
+    auto current = state.load();
+    wxVector<std::optional<wxFileName>> results(iconNames.size());
 
-    std::set<wxString> visited;
+    // Names not in the lookup cache, cached misses included.
+    std::vector<wxString> pendingNames;
+    std::vector<size_t> pendingIndexes;
+    for (size_t i = 0; i < iconNames.size(); ++i) {
+        if (auto cached = current->lookupCache.Find({theme, iconNames[i], size, scale})) {
+            results[i] = cached->value;
+            CountLookups(cached->value.has_value());
+        } else {
+            pendingNames.push_back(iconNames[i]);
+            pendingIndexes.push_back(i);
+        }
+    }
+    lookupHits += iconNames.size() - pendingNames.size();
+    if (current->lookupCache.GetCapacity() != 0) {
+        lookupMisses += pendingNames.size();
+    }
+    if (pendingNames.empty()) return results;
 
-    // Recurse through current + inherited themes
-    std::function<void(const wxString&)> collectIcons = [&](const wxString& themeName) {
-        if (visited.count(themeName)) return;
-        visited.insert(themeName);
+    // Each theme of the chain is probed once for all the names it did not resolve.
+    wxVector<std::optional<wxFileName>> found(pendingNames.size());
+    auto chain = GetThemeChain(*current, theme);
+    size_t missing = pendingNames.size();
+    for (size_t depth = 0; depth < chain->size() && missing > 0; ++depth) {
+        size_t stillMissing = (*chain)[depth]->FindIcons(pendingNames, size, scale, found);
+        CountLookups(true, depth, missing - stillMissing);
+        missing = stillMissing;
+    }
+    CountLookups(false, 0, missing);
 
-        auto it = themes.find(themeName);
-        if (it == themes.end()) return;
+    for (size_t i = 0; i < pendingNames.size(); ++i) {
+        current->lookupCache.Insert({theme, pendingNames[i], size, scale}, found[i]);
+        results[pendingIndexes[i]] = std::move(found[i]);
+    }
+    return results;
+}
 
-        auto subIcons = it->second.FindAllIcons(iconName);
-        for (const auto& [size, file] : subIcons) {
-            foundIcons[size] = file;
-        }
+std::map<int, wxFileName> FreeDesktopIconProvider::FindAllIcons(const wxString& iconName) const {
+    std::map<int, wxFileName> foundIcons;
 
-        for (const auto& parent : it->second.GetInherits()) {
-            collectIcons(parent);
+    // Current + inherited themes, the closest theme wins for a given size
+    for (const auto& theme : *GetThemeChain(currentTheme)) {
+        for (const auto& [size, file] : theme->FindAllIcons(iconName)) {
+            foundIcons.emplace(size, file);
         }
-    };
+    }
+    return foundIcons;
+}
 
-    collectIcons(currentTheme);
+std::optional<wxBitmapBundle> FreeDesktopIconProvider::LoadIconBundle(const wxString& iconName) const {
+    TraceScope trace("LoadIconBundle");
+    std::map<int, wxString> files;
+    for (const auto& [size, file] : FindAllIcons(iconName)) {
+        files[size] = file.GetFullPath();
+    }
+    if (files.empty()) return std::nullopt;
 
-    if (foundIcons.empty()) return std::nullopt;
+    return wxBitmapBundle::FromImpl(new IconBundleImpl(files, GetImageCache()));
+}
 
-    wxVector<wxBitmap> bitmaps;
-    for (const auto& [size, file] : foundIcons) {
-        // TODO Preload through wxImage to handle SVGs and PNGs
-        wxBitmap bmp(file.GetFullPath(), wxBITMAP_TYPE_ANY);
-        if (bmp.IsOk())
-            bitmaps.push_back(bmp);
-    }
+void FreeDesktopIconProvider::LoadIconBundleAsync(const wxString& iconName, IconBundleCallback callback, wxEvtHandler* handler) {
+    wxEvtHandler* target = handler != nullptr ? handler : wxTheApp;
+    wxCHECK_RET(target != nullptr, "LoadIconBundleAsync needs an event handler");
 
-    if (bitmaps.empty()) return std::nullopt;
+    // The callback may capture wx objects, whose ref counting is not atomic either: it is shared rather than
+    // copied across threads, CallAfter() copying its functor, and only run and destroyed on the main thread.
+    auto sharedCallback = std::make_shared<IconBundleCallback>(std::move(callback));
+    workers.Submit([this, iconName, sharedCallback, target]() {
+        TraceScope trace("LoadIconBundleAsync");
+        auto cache = GetImageCache();
+        // Shared, so the images themselves are never copied across threads, their ref counting is not atomic.
+        auto images = std::make_shared<wxVector<wxImage>>();
+        auto files = std::make_shared<wxVector<std::pair<wxString, int>>>();
+        for (const auto& [size, file] : FindAllIcons(iconName)) {
+            files->push_back({file.GetFullPath(), size});
+            images->push_back(cache->Load(file.GetFullPath(), size));
+        }
 
-    return wxBitmapBundle::FromBitmaps(bitmaps);
+        target->CallAfter([sharedCallback, cache, images, files]() {
+            TraceScope trace("LoadIconBundleAsync::Callback");
+            // SVG sizes never rasterized before can only be rendered here.
+            for (size_t i = 0; i < images->size(); ++i) {
+                const auto& [path, size] = (*files)[i];
+                if (!(*images)[i].IsOk() && IconImageCache::IsSvg(path)) {
+                    (*images)[i] = cache->Load(path, size);
+                }
+            }
+            IconBundleCallback callback = std::move(*sharedCallback);
+            callback(MakeBundle(*images));
+        });
+    });
 }
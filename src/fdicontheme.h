@@ -28,48 +28,237 @@
 
 #include <wx/string.h>
 #include <wx/filename.h>
-#include <wx/fileconf.h>
+#include <wx/hashmap.h>
+#include <atomic>
 #include <map>
 #include <set>
+#include <span>
 #include <optional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "iconimagecache.h"
+#include "iconindex.h"
+#include "iconnameindex.h"
+#include "slotcache.h"
+#include "themewatcher.h"
+#include "workerpool.h"
+
+class GtkIconCache;
 
 
 struct IconDirectory {
+    enum Type { FIXED, SCALABLE, THRESHOLD };
+
+    wxString name; // Section name in index.theme, relative to the theme path
     wxString path;
     int size = 0;
-    int minSize = 0;
-    int maxSize = 0;
-    wxString type;
+    int minSize = 0;   // Defaults to size
+    int maxSize = 0;   // Defaults to size
+    int threshold = 2;
+    int scale = 1;
+    Type type = THRESHOLD;
+
+    /** DirectoryMatchesSize() of the Icon Theme Specification. */
+    bool MatchesSize(int iconSize, int iconScale) const;
+    /** DirectorySizeDistance() of the Icon Theme Specification. */
+    int SizeDistance(int iconSize, int iconScale) const;
 };
 
+/** Counters of an IconTheme, since its creation or the last reset. Times are wall clock microseconds. */
+struct IconThemeStats {
+    size_t directoriesScanned = 0;
+    size_t filesIndexed = 0;   // Icon files found by directory scans
+    size_t indexBuilds = 0;    // Full indexes built by scanning
+    size_t cacheLoads = 0;     // Indexes loaded from the GTK or persistent cache
+    uint64_t indexBuildTime = 0; // Spent probing caches and building indexes
+    uint64_t preloadTime = 0;    // Spent parsing index.theme
+    size_t iconsFound = 0;     // FindIcon() and FindIcons() results
+    size_t iconsMissing = 0;
+
+    IconThemeStats& operator+=(const IconThemeStats& other);
+};
+
+/**
+ * Theme lookups are const and can run from any number of threads at once: everything built on demand
+ * (index.theme content, icon index, size tables) is published once complete, and never modified afterwards.
+ * Settings are to be changed before the theme is shared between threads.
+ */
 class IconTheme {
 public:
     IconTheme(const wxString& themePath);
-    IconTheme(const IconTheme&) = default;
-    IconTheme(IconTheme&&) = default;
-    IconTheme& operator=(const IconTheme&) = default;
-    IconTheme& operator=(IconTheme&&) = default;
+    // Shared between threads and snapshots through std::shared_ptr rather than copied.
+    IconTheme(const IconTheme&) = delete;
+    IconTheme& operator=(const IconTheme&) = delete;
 
+    /**
+     * Only read the theme name from index.theme, and check it describes icon directories.
+     * The rest of index.theme is parsed on first use, or by Preload().
+     */
+    bool Discover();
     bool Preload();
+    bool IsLoaded() const { return loaded; }
+
     const wxString& GetName() const { return name; }
-    const wxVector<IconDirectory>& GetDirectories() const { return directories; }
-    const wxVector<wxString>& GetInherits() const { return inherits; }
+    const wxString& GetPath() const { return path; }
+    const wxVector<IconDirectory>& GetDirectories() const { EnsureLoaded(); return directories; }
+    const wxVector<wxString>& GetInherits() const { EnsureLoaded(); return inherits; }
 
-    std::optional<wxFileName> FindIcon(const wxString& iconName, int size);
+    /** Icon of the theme (without inheritance) best matching the size, as defined by the Icon Theme Specification. */
+    std::optional<wxFileName> FindIcon(const wxString& iconName, int size, int scale = 1) const;
 
+    /**
+     * FindIcon() for each name whose result is still empty, results having one slot per name.
+     * The index and the size table are looked up once for all. Returns the number of names still not found.
+     */
+    size_t FindIcons(std::span<const wxString> iconNames, int size, int scale, wxVector<std::optional<wxFileName>>& results) const;
+
+    /** All files of the icon, by pixel size (size * scale). */
     std::map<int, wxFileName> FindAllIcons(const wxString& iconName) const;
 
     std::set<wxString> GetIconNames() const;
 
+    /**
+     * UTF-8 names of the icons of the theme, sorted by bytes (so by code point) and unique.
+     * Computed once per index, the pointers stay valid as long as the returned array is held.
+     */
+    std::shared_ptr<const std::vector<const char*>> GetSortedIconNames() const;
+
+    /**
+     * Rescan one directory after its content changed, patching its entries into the published index,
+     * the other directories keeping theirs. Like building the index, refreshing it does not change the theme.
+     */
+    void RefreshDirectory(size_t dirIndex) const;
+
+    /**
+     * Directory where indexes built by scanning are persisted, to be memory-mapped by later runs.
+     * Defaults to GetDefaultIndexCacheDirectory(), empty to disable.
+     */
+    void SetIndexCacheDirectory(const wxString& dir) { indexCacheDir = dir; }
+    const wxString& GetIndexCacheDirectory() const { return indexCacheDir; }
+
+    /** $XDG_CACHE_HOME/wxFDIconTheme, or ~/.cache/wxFDIconTheme */
+    static wxString GetDefaultIndexCacheDirectory();
+
+    /**
+     * In lazy mode, FindIcon() scans directories on demand, best matching ones first, and stops at the first match.
+     * The full index is only built when needed, by FindAllIcons() and GetIconNames().
+     * GTK and persistent caches are still preferred when available.
+     */
+    void SetLazyScan(bool lazy) { lazyScan = lazy; }
+    bool IsLazyScan() const { return lazyScan; }
+
+    /**
+     * Number of threads scanning directories when the full index is built.
+     * 1 (default) scans on the calling thread, 0 uses one thread per core.
+     * The resulting index does not depend on it.
+     */
+    void SetBuildThreadCount(unsigned int count) { buildThreads = count; }
+    unsigned int GetBuildThreadCount() const { return buildThreads; }
+
+    /** Snapshot of the counters, which are updated by all the threads using the theme. */
+    IconThemeStats GetStats() const;
+    void ResetStats();
+
 private:
     wxString path;
-    wxString name;
-    wxVector<wxString> inherits;
-    wxVector<IconDirectory> directories;
 
-    mutable std::map<wxString, std::map<int, wxFileName>> iconCache;
+    // The name comes from Discover(), everything else is parsed from index.theme once, on first use.
+    mutable std::once_flag loadOnce;
+    mutable std::atomic<bool> loaded{false};
+    mutable bool valid = false;
+    mutable wxString name;
+    mutable wxVector<wxString> inherits;
+    mutable wxVector<IconDirectory> directories;
+    wxString indexCacheDir;
+    bool lazyScan = false;
+    unsigned int buildThreads = 1;
 
-    void BuildCache(bool force = false)const;
+    // Where the icons are: the GTK icon-theme.cache or persistent index when up to date, a scanned index otherwise.
+    struct Index {
+        std::shared_ptr<const GtkIconCache> gtkCache;
+        wxVector<int> gtkCacheDirectories; // Cache directory index -> index in directories, -1 if unknown
+        IconIndex iconIndex;
+
+        // Names pointing into gtkCache or iconIndex, sorted on first enumeration.
+        mutable std::once_flag sortOnce;
+        mutable std::vector<const char*> sortedNames;
+    };
+    // Published once complete, lookups pick it up without locking. Builders are serialized by buildMutex.
+    mutable std::atomic<std::shared_ptr<const Index>> index;
+    mutable std::mutex buildMutex;
+    mutable std::atomic<bool> cachesProbed{false}; // GTK and persistent caches looked up
+
+    // Icon files of a directory, sorted by name then extension preference.
+    struct ListedIcon {
+        wxString name;
+        IconIndex::Extension extension;
+
+        bool operator<(const ListedIcon& other) const {
+            return name != other.name ? name < other.name : extension < other.extension;
+        }
+    };
+    wxVector<ListedIcon> ScanDirectory(size_t dirIndex) const;
+
+    // Listings per directory, scanned on demand until the full index is built.
+    typedef std::shared_ptr<const wxVector<ListedIcon>> Listing;
+    mutable std::vector<std::atomic<Listing>> listings;
+    mutable std::atomic<time_t> scanTime{0};
+
+    bool Load() const;
+    bool Parse() const;
+    void EnsureLoaded() const { if (!loaded) Load(); }
+
+    /** The published index, building it if needed. Without build, it is only looked up in caches. */
+    std::shared_ptr<const Index> GetIndex(bool build) const;
+    std::shared_ptr<const Index> ProbeCaches() const;
+    /** Persistent for an index written by WriteIndexCache(), which must list all the directories. */
+    std::shared_ptr<const Index> LoadGtkCache(const wxString& cacheFile, bool persistent = false) const;
+    std::shared_ptr<const Index> ScanIndex() const;
+    static std::shared_ptr<const Index> MakeIndex(const std::vector<Listing>& dirListings);
+    /** Names per directory of an index, as scanned. */
+    std::vector<Listing> GetIndexListings(const Index& from) const;
+    Listing GetListing(size_t dirIndex) const;
+    std::optional<wxFileName> FindIconLazily(const wxString& iconName, int size, int scale) const;
+    std::optional<wxFileName> FindInListing(const wxVector<ListedIcon>& listing, size_t dirIndex, const wxString& iconName) const;
+
+    // Directories ordered by preference for a requested size and scale:
+    // the ones matching the size first, then by size distance, then in index.theme order.
+    struct SizeLookup {
+        wxVector<uint16_t> order; // Directory indexes, best first
+        wxVector<uint16_t> rank;  // Directory index -> position in order
+    };
+    // Computed on demand for sizes up to MAX_CACHED_SIZE and scales up to MAX_CACHED_SCALE, on the fly beyond.
+    static constexpr int MAX_CACHED_SIZE = 256;
+    static constexpr int MAX_CACHED_SCALE = 3;
+    mutable std::vector<std::atomic<std::shared_ptr<const SizeLookup>>> sizeLookups;
+    std::shared_ptr<const SizeLookup> GetSizeLookup(int size, int scale) const;
+
+    std::optional<wxFileName> FindInIndex(const Index& from, const SizeLookup& lookup, const wxString& iconName) const;
+
+    // Call fn(const IconIndex::Entry&) for each file of the icon, in directory order.
+    template<typename Fn>
+    static void ForEachEntry(const Index& index, const wxString& iconName, Fn&& fn);
+    wxFileName GetIconFile(const wxString& iconName, const IconIndex::Entry& entry) const;
+    /** Version of the persistent index content, part of its file name so files of other versions are never read. */
+    static constexpr unsigned int INDEX_CACHE_VERSION = 1;
+    wxString GetIndexCacheFile() const;
+    void WriteIndexCache(const std::vector<Listing>& dirListings, time_t since) const;
+
+    // See IconThemeStats
+    struct Counters {
+        std::atomic<size_t> directoriesScanned{0};
+        std::atomic<size_t> filesIndexed{0};
+        std::atomic<size_t> indexBuilds{0};
+        std::atomic<size_t> cacheLoads{0};
+        std::atomic<uint64_t> indexBuildTime{0};
+        std::atomic<uint64_t> preloadTime{0};
+        std::atomic<size_t> iconsFound{0};
+        std::atomic<size_t> iconsMissing{0};
+    };
+    mutable Counters counters;
 };
 
 
@@ -89,6 +278,53 @@ struct ThemeDirectory
 };
 
 
+struct IconLookupKey {
+    wxString theme;
+    wxString iconName;
+    int size;
+    int scale;
+
+    bool operator==(const IconLookupKey& other) const {
+        return size == other.size && scale == other.scale && iconName == other.iconName && theme == other.theme;
+    }
+};
+
+struct IconLookupKeyHash {
+    size_t operator()(const IconLookupKey& key) const {
+        wxStringHash hash;
+        return hash(key.iconName) ^ (hash(key.theme) * 31) ^ ((size_t) key.size << 8) ^ key.scale;
+    }
+};
+
+struct IconLookupCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t count = 0;
+    size_t capacity = 0;
+};
+
+/** Counters of a FreeDesktopIconProvider, since its creation or the last reset. Times are wall clock microseconds. */
+struct IconProviderStats {
+    size_t iconsFound = 0;       // FindIcon() and FindIcons() results, lookup cache hits included
+    size_t iconsMissing = 0;
+    size_t fallbacks = 0;        // Icons resolved from an inherited theme rather than the requested one, cache hits excluded
+    size_t fallbackDepth = 0;    // Sum of the chain positions of the themes they were found in
+    size_t maxFallbackDepth = 0;
+    uint64_t preloadTime = 0;    // Spent in PreloadThemes()
+    IconLookupCacheStats lookupCache;
+    IconThemeStats themes;       // Sum over the themes of the current paths
+    size_t imagesDecoded = 0;    // By the image cache, see IconImageCache::GetDecodedCount()
+    size_t bytesDecoded = 0;
+};
+
+/** Themes to look icons up in, in order, shared with the themes they reference. */
+typedef wxVector<std::shared_ptr<const IconTheme>> IconThemeChain;
+
+/**
+ * Lookups can run from any number of threads at once, without locking: they work on an immutable snapshot
+ * of the search paths and themes. Changing the paths publishes a new snapshot, lookups already running
+ * finish on the previous one.
+ */
 class FreeDesktopIconProvider {
 public:
     FreeDesktopIconProvider();
@@ -101,24 +337,164 @@ public:
 
     wxVector<wxString> GetThemeNames() const;
 
+    /**
+     * Themes to look icons up in, in order: the theme, its parents depth first, and hicolor last.
+     * Each theme appears once, so cyclic Inherits= are harmless. Computed once per theme, until the paths change.
+     */
+    std::shared_ptr<const IconThemeChain> GetThemeChain(const wxString& themeName) const;
+
     std::set<wxString> GetIconNames(const wxString& themeName) const;
     std::set<wxString> GetIconNames() const;
 
-    std::optional<wxFileName> FindIcon(const wxString& iconName, int size);
-    std::optional<wxFileName> FindIcon(const wxString& theme, const wxString& iconName, int size);
+    /** Receives UTF-8 icon names, valid during the call only. Returns false to stop the enumeration. */
+    typedef std::function<bool(const char* iconName)> IconNameVisitor;
+
+    /**
+     * Enumerate the names of the icons of the theme chain, sorted and unique, without copying them:
+     * the sorted names of the themes are merged on the fly. Returns false if the visitor stopped it.
+     */
+    bool ForEachIconName(const wxString& themeName, const IconNameVisitor& visitor) const;
+
+    /**
+     * Names of the icons of the theme chain matching the query, sorted and without duplicates,
+     * at most limit of them (0 for all). See IconNameIndex::Search() for the query syntax.
+     * The names of a chain are indexed by its first search, until the paths change.
+     */
+    wxVector<wxString> SearchIconNames(const wxString& themeName, const wxString& query, size_t limit = 0) const;
+
+    std::optional<wxFileName> FindIcon(const wxString& iconName, int size, int scale = 1) const;
+    std::optional<wxFileName> FindIcon(const wxString& theme, const wxString& iconName, int size, int scale = 1) const;
+
+    /**
+     * FindIcon() for many names at once, results being in the order of the names.
+     * The theme chain is walked once, each theme being probed for all the names still unresolved.
+     */
+    wxVector<std::optional<wxFileName>> FindIcons(const wxString& theme, std::span<const wxString> iconNames, int size, int scale = 1) const;
+
+    /** All files of the icon in the current theme chain, by pixel size, the closest theme winning. */
+    std::map<int, wxFileName> FindAllIcons(const wxString& iconName) const;
+
+    /**
+     * Bundle of all the sizes of the icon. Files are only decoded when a size is drawn, see IconBundleImpl.
+     * Main thread only, SVG files being rasterized on demand.
+     */
+    std::optional<wxBitmapBundle> LoadIconBundle(const wxString& iconName) const;
+
+    typedef std::function<void(std::optional<wxBitmapBundle>)> IconBundleCallback;
+
+    /**
+     * Same as LoadIconBundle(), but index building, file resolution and decoding of all the sizes run on
+     * background threads, for bundles drawn right away.
+     * The bundle is then built and passed to the callback on the main thread, through handler->CallAfter(),
+     * handler defaulting to wxTheApp. The handler must outlive the request.
+     * Requests still queued when the provider is destroyed are dropped, their callbacks never run.
+     */
+    void LoadIconBundleAsync(const wxString& iconName, IconBundleCallback callback, wxEvtHandler* handler = nullptr);
+
+    /**
+     * Decoded images used by the loaders. Each provider has its own by default,
+     * it can be shared between providers.
+     */
+    std::shared_ptr<IconImageCache> GetImageCache() const;
+    void SetImageCache(const std::shared_ptr<IconImageCache>& cache);
 
-    std::optional<wxBitmapBundle> LoadIconBundle(const wxString& iconName);
+    /** See IconTheme::SetIndexCacheDirectory(), applies to themes and paths added afterwards. */
+    void SetIndexCacheDirectory(const wxString& dir);
+
+    /** See IconTheme::SetLazyScan(), applies to themes and paths added afterwards. */
+    void SetLazyScan(bool lazy);
+
+    /** See IconTheme::SetBuildThreadCount(), applies to themes and paths added afterwards. */
+    void SetBuildThreadCount(unsigned int count);
+
+    /**
+     * FindIcon() results, including misses, are kept in a SlotCache of the given number of slots (0 to disable),
+     * read and filled without locking. The cache is emptied whenever the search paths or its capacity change.
+     * Misses are only counted while the cache is enabled.
+     */
+    void SetLookupCacheCapacity(size_t capacity);
+    IconLookupCacheStats GetLookupCacheStats() const;
+    void ResetLookupCacheStats();
+
+    /**
+     * Snapshot of the provider counters, with the ones of its themes and image cache.
+     * Counters are updated without locking, a snapshot taken during lookups may be slightly inconsistent.
+     */
+    IconProviderStats GetStats() const;
+    /** Reset the provider counters, the lookup cache, theme and image cache ones included. */
+    void ResetStats();
+
+    /**
+     * Themes are only discovered when paths are added, their index.theme being parsed on first use.
+     * Parse all of them now instead, from threadCount threads (0 for one per core).
+     */
+    void PreloadThemes(unsigned int threadCount = 0);
+
+    /**
+     * Watch the themes used for lookups with inotify (Linux only). Added and removed icons are then picked up
+     * by rescanning the affected directories only, and themes whose index.theme changes are reloaded.
+     * Returns false when watching is not supported.
+     */
+    bool SetWatching(bool watch);
+    bool IsWatching() const;
 
 protected:
-    ThemeDirectory LoadThemesFromDirectory(const wxFileName& dirPath);
+    // Snapshot of the search paths, defined with the implementation.
+    struct State;
+
+    /** Discover the themes of the directory, adding them to the state unless their name is already known. */
+    ThemeDirectory LoadThemesFromDirectory(const wxFileName& dirPath, State& state) const;
+
+    /** Undiscovered theme, with the provider settings. */
+    std::shared_ptr<IconTheme> CreateTheme(const wxString& themePath) const;
+
+    /** Replace the theme by a freshly discovered and loaded one, or drop it if it is no longer valid. */
+    void ReloadTheme(State& state, const wxString& themePath) const;
+
+    /** Theme by name, or by directory name as used in Inherits= */
+    static std::shared_ptr<const IconTheme> FindTheme(const State& state, const wxString& themeName);
+
+    std::shared_ptr<const IconThemeChain> GetThemeChain(const State& state, const wxString& themeName) const;
 
 private:
-    wxVector<ThemeDirectory> directories;
+    // Current snapshot. Writers copy it, modify the copy and publish it, serialized by writeMutex,
+    // which also guards the settings below.
+    std::atomic<std::shared_ptr<const State>> state;
+    std::mutex writeMutex;
+
+    /** New snapshot sharing the themes of the current one, with empty lookup caches. */
+    std::shared_ptr<State> CopyState() const;
+
+    /** Called by the watcher once indexes are patched, publishes a new snapshot. */
+    void OnThemesChanged(const wxVector<wxString>& changedThemes);
+
+    std::atomic<std::shared_ptr<IconImageCache>> imageCache{std::make_shared<IconImageCache>()};
+    std::atomic<size_t> lookupCacheCapacity{4096};
+    mutable std::atomic<size_t> lookupHits{0};
+    mutable std::atomic<size_t> lookupMisses{0};
+
+    // See IconProviderStats
+    struct Counters {
+        std::atomic<size_t> iconsFound{0};
+        std::atomic<size_t> iconsMissing{0};
+        std::atomic<size_t> fallbacks{0};
+        std::atomic<size_t> fallbackDepth{0};
+        std::atomic<size_t> maxFallbackDepth{0};
+        std::atomic<uint64_t> preloadTime{0};
+    };
+    mutable Counters counters;
+    /** Count lookup results, depth being the position in the chain of the theme found icons come from. */
+    void CountLookups(bool found, size_t depth = 0, size_t count = 1) const;
+    const wxString currentTheme = "hicolor";
+    wxString indexCacheDir = IconTheme::GetDefaultIndexCacheDirectory();
+    bool lazyScan = false;
+    unsigned int buildThreads = 1;
 
-    //ThemeDirectoryManager& dirs;
-    std::map<wxString, IconTheme> themes;
-    wxString currentTheme = "hicolor";
+    // Destroyed before the snapshot and its mutex, as its thread uses them.
+    std::atomic<std::shared_ptr<ThemeWatcher>> watcher;
 
+    // Last member, so running background loads finish before anything else is destroyed.
+    WorkerPool workers;
 };
 
 
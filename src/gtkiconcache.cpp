@@ -0,0 +1,283 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#include "gtkiconcache.h"
+
+#include <wx/file.h>
+#include <wx/log.h>
+
+#include <cstring>
+#include <vector>
+
+#ifdef __UNIX__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    constexpr uint16_t MAJOR_VERSION = 1;
+    constexpr uint16_t MINOR_VERSION = 0;
+    constexpr uint32_t INVALID_OFFSET = 0xFFFFFFFF;
+
+    class CacheBuffer {
+    public:
+        uint32_t Offset() const { return data.size(); }
+
+        void AppendUInt16(uint16_t value) {
+            data.push_back((char) (value >> 8));
+            data.push_back((char) value);
+        }
+
+        void AppendUInt32(uint32_t value) {
+            AppendUInt16((uint16_t) (value >> 16));
+            AppendUInt16((uint16_t) value);
+        }
+
+        // NUL terminated and padded to 4 bytes, like gtk-update-icon-cache does.
+        void AppendString(const char* str) {
+            size_t len = std::strlen(str) + 1;
+            data.insert(data.end(), str, str + len);
+            data.resize((data.size() + 3) & ~3, '\0');
+        }
+
+        void SetUInt32(uint32_t offset, uint32_t value) {
+            data[offset] = (char) (value >> 24);
+            data[offset + 1] = (char) (value >> 16);
+            data[offset + 2] = (char) (value >> 8);
+            data[offset + 3] = (char) value;
+        }
+
+        const std::vector<char>& GetData() const { return data; }
+
+    private:
+        std::vector<char> data;
+    };
+}
+
+GtkIconCache::~GtkIconCache() {
+#ifdef __UNIX__
+    if (mapped) {
+        munmap(const_cast<char*>(buffer), size);
+        return;
+    }
+#endif
+    delete[] buffer;
+}
+
+std::shared_ptr<GtkIconCache> GtkIconCache::Open(const wxString& cacheFile) {
+    std::shared_ptr<GtkIconCache> cache(new GtkIconCache());
+
+#ifdef __UNIX__
+    int fd = open(cacheFile.fn_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 12) {
+        close(fd);
+        return nullptr;
+    }
+
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return nullptr;
+
+    cache->buffer = static_cast<const char*>(map);
+    cache->size = st.st_size;
+    cache->mapped = true;
+    cache->mtime = st.st_mtime;
+#else
+    wxFile file;
+    if (!wxFile::Exists(cacheFile) || !file.Open(cacheFile)) return nullptr;
+    wxFileOffset length = file.Length();
+    if (length < 12) return nullptr;
+
+    char* data = new char[length];
+    cache->buffer = data;
+    cache->size = length;
+    if (file.Read(data, length) != length) return nullptr;
+    cache->mtime = wxFileModificationTime(cacheFile);
+#endif
+
+    if (cache->GetUInt16(0) != MAJOR_VERSION || cache->GetUInt16(2) != MINOR_VERSION) return nullptr;
+
+    // Validate the hash table bounds once, so lookups can trust them.
+    uint32_t hashOffset = cache->GetUInt32(4);
+    uint32_t bucketCount = cache->GetUInt32(hashOffset);
+    if (bucketCount == 0 || bucketCount == INVALID_OFFSET
+            || (uint64_t) hashOffset + 4 + 4 * (uint64_t) bucketCount > cache->size) {
+        return nullptr;
+    }
+
+    // Walk the chains once, so lookups can't loop forever on a damaged file. Icon entries taking
+    // 12 bytes, more of them than the file can hold means a cycle.
+    uint64_t maxIcons = cache->size / 12;
+    uint64_t iconCount = 0;
+    for (uint32_t bucket = 0; bucket < bucketCount; ++bucket) {
+        for (uint32_t chain = cache->GetUInt32(hashOffset + 4 + 4 * bucket); chain != INVALID_OFFSET; chain = cache->GetUInt32(chain)) {
+            if ((uint64_t) chain + 12 > cache->size || ++iconCount > maxIcons) return nullptr;
+        }
+    }
+
+    uint32_t dirListOffset = cache->GetUInt32(8);
+    uint32_t dirCount = cache->GetUInt32(dirListOffset);
+    if (dirCount == INVALID_OFFSET || (uint64_t) dirListOffset + 4 + 4 * (uint64_t) dirCount > cache->size) {
+        return nullptr;
+    }
+    for (uint32_t i = 0; i < dirCount; ++i) {
+        const char* dirName = cache->GetString(cache->GetUInt32(dirListOffset + 4 + 4 * i));
+        if (dirName == nullptr) return nullptr;
+        cache->directories.push_back(wxString::FromUTF8(dirName));
+    }
+
+    return cache;
+}
+
+uint16_t GtkIconCache::GetUInt16(uint32_t offset) const {
+    if ((uint64_t) offset + 2 > size) return 0xFFFF;
+    const auto* p = reinterpret_cast<const unsigned char*>(buffer + offset);
+    return (uint16_t) ((p[0] << 8) | p[1]);
+}
+
+uint32_t GtkIconCache::GetUInt32(uint32_t offset) const {
+    if ((uint64_t) offset + 4 > size) return INVALID_OFFSET;
+    const auto* p = reinterpret_cast<const unsigned char*>(buffer + offset);
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+}
+
+const char* GtkIconCache::GetString(uint32_t offset) const {
+    if (offset >= size) return nullptr;
+    if (std::memchr(buffer + offset, '\0', size - offset) == nullptr) return nullptr;
+    return buffer + offset;
+}
+
+GtkIconCache::ImageList GtkIconCache::GetImageList(uint32_t offset) const {
+    ImageList list;
+    uint32_t count = GetUInt32(offset);
+    if (count != INVALID_OFFSET && (uint64_t) offset + 4 + 8 * (uint64_t) count <= size) {
+        list.cache = this;
+        list.offset = offset + 4;
+        list.count = count;
+    }
+    return list;
+}
+
+GtkIconCache::Image GtkIconCache::ImageList::operator[](uint32_t index) const {
+    return {cache->GetUInt16(offset + 8 * index), cache->GetUInt16(offset + 8 * index + 2)};
+}
+
+uint32_t GtkIconCache::Hash(const char* name) {
+    // Same as icon_name_hash() in GTK, including the signed char arithmetic.
+    const signed char* p = reinterpret_cast<const signed char*>(name);
+    uint32_t h = *p;
+    if (h != 0) {
+        for (p += 1; *p != '\0'; ++p) {
+            h = (h << 5) - h + *p;
+        }
+    }
+    return h;
+}
+
+GtkIconCache::ImageList GtkIconCache::FindImages(const char* iconName) const {
+    uint32_t hashOffset = GetUInt32(4);
+    uint32_t bucketCount = GetUInt32(hashOffset);
+    uint32_t chain = GetUInt32(hashOffset + 4 + 4 * (Hash(iconName) % bucketCount));
+    while (chain != INVALID_OFFSET) {
+        const char* name = GetString(GetUInt32(chain + 4));
+        if (name == nullptr) break;
+        if (std::strcmp(name, iconName) == 0) {
+            return GetImageList(GetUInt32(chain + 8));
+        }
+        chain = GetUInt32(chain);
+    }
+    return {};
+}
+
+bool GtkIconCache::Write(const wxString& cacheFile, const wxVector<wxString>& directories,
+                         const std::map<wxString, wxVector<Image>>& icons) {
+    CacheBuffer buffer;
+
+    // Header
+    buffer.AppendUInt16(MAJOR_VERSION);
+    buffer.AppendUInt16(MINOR_VERSION);
+    buffer.AppendUInt32(0); // Hash offset
+    buffer.AppendUInt32(0); // Directory list offset
+
+    // Hash table, buckets are filled while appending icons
+    uint32_t bucketCount = icons.size() | 1;
+    uint32_t hashOffset = buffer.Offset();
+    buffer.SetUInt32(4, hashOffset);
+    buffer.AppendUInt32(bucketCount);
+    for (uint32_t i = 0; i < bucketCount; ++i) {
+        buffer.AppendUInt32(INVALID_OFFSET);
+    }
+
+    // Chain tails per bucket, to patch the next pointer of the last icon
+    std::vector<uint32_t> tails(bucketCount, 0);
+    for (const auto& [iconName, images] : icons) {
+        const wxScopedCharBuffer utf8 = iconName.utf8_str();
+        uint32_t bucket = Hash(utf8.data()) % bucketCount;
+
+        uint32_t iconOffset = buffer.Offset();
+        if (tails[bucket] == 0) {
+            buffer.SetUInt32(hashOffset + 4 + 4 * bucket, iconOffset);
+        } else {
+            buffer.SetUInt32(tails[bucket], iconOffset);
+        }
+        tails[bucket] = iconOffset;
+
+        buffer.AppendUInt32(INVALID_OFFSET); // Chain
+        buffer.AppendUInt32(iconOffset + 12); // Name
+        buffer.AppendUInt32(0); // Image list
+        buffer.AppendString(utf8.data());
+
+        buffer.SetUInt32(iconOffset + 8, buffer.Offset());
+        buffer.AppendUInt32(images.size());
+        for (const auto& image : images) {
+            buffer.AppendUInt16(image.directory);
+            buffer.AppendUInt16(image.flags);
+            buffer.AppendUInt32(0); // No image data
+        }
+    }
+
+    // Directory list
+    uint32_t dirListOffset = buffer.Offset();
+    buffer.SetUInt32(8, dirListOffset);
+    buffer.AppendUInt32(directories.size());
+    for (size_t i = 0; i < directories.size(); ++i) {
+        buffer.AppendUInt32(0);
+    }
+    for (size_t i = 0; i < directories.size(); ++i) {
+        buffer.SetUInt32(dirListOffset + 4 + 4 * i, buffer.Offset());
+        buffer.AppendString(directories[i].utf8_str());
+    }
+
+    wxLogNull noLog;
+    wxTempFile file;
+    if (!file.Open(cacheFile)) return false;
+    if (!file.Write(buffer.GetData().data(), buffer.GetData().size())) {
+        file.Discard();
+        return false;
+    }
+    return file.Commit();
+}
@@ -0,0 +1,124 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#ifndef WXFDICONTHEME_GTKICONCACHE_H
+#define WXFDICONTHEME_GTKICONCACHE_H
+
+#include <wx/string.h>
+#include <wx/vector.h>
+
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <memory>
+
+/**
+ * Read-only view over a GTK "icon-theme.cache" file.
+ *
+ * The file is memory-mapped and queried in place, nothing is copied
+ * except the directory list.
+ * Format reference: gtk/gtkiconcache.c and gtk-update-icon-cache.
+ */
+class GtkIconCache {
+public:
+    enum ImageFlags {
+        HAS_SUFFIX_XPM = 1 << 0,
+        HAS_SUFFIX_SVG = 1 << 1,
+        HAS_SUFFIX_PNG = 1 << 2,
+        HAS_ICON_FILE  = 1 << 3
+    };
+
+    struct Image {
+        uint16_t directory; // Index in GetDirectories()
+        uint16_t flags;     // Combination of ImageFlags
+    };
+
+    class ImageList {
+    public:
+        uint32_t GetCount() const { return count; }
+        Image operator[](uint32_t index) const;
+    private:
+        friend class GtkIconCache;
+        const GtkIconCache* cache = nullptr;
+        uint32_t offset = 0;
+        uint32_t count = 0;
+    };
+
+    ~GtkIconCache();
+    GtkIconCache(const GtkIconCache&) = delete;
+    GtkIconCache& operator=(const GtkIconCache&) = delete;
+
+    /** Map the given cache file, return nullptr if missing or not a valid cache, cyclic hash chains included. */
+    static std::shared_ptr<GtkIconCache> Open(const wxString& cacheFile);
+
+    /**
+     * Write a cache file in the same format, atomically replacing any previous one.
+     * Image::directory refers to the given directories.
+     */
+    static bool Write(const wxString& cacheFile, const wxVector<wxString>& directories,
+                      const std::map<wxString, wxVector<Image>>& icons);
+
+    time_t GetModificationTime() const { return mtime; }
+
+    /** Directories, relative to the theme path, referenced by Image::directory. */
+    const wxVector<wxString>& GetDirectories() const { return directories; }
+
+    ImageList FindImages(const char* iconName) const;
+
+    /** Call fn(const char* iconName, const ImageList& images) for each icon of the cache. */
+    template<typename Fn>
+    void ForEachIcon(Fn&& fn) const;
+
+private:
+    GtkIconCache() = default;
+
+    const char* buffer = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+    time_t mtime = 0;
+    wxVector<wxString> directories;
+
+    uint16_t GetUInt16(uint32_t offset) const;
+    uint32_t GetUInt32(uint32_t offset) const;
+    const char* GetString(uint32_t offset) const;
+    ImageList GetImageList(uint32_t offset) const;
+
+    static uint32_t Hash(const char* name);
+};
+
+template<typename Fn>
+void GtkIconCache::ForEachIcon(Fn&& fn) const {
+    uint32_t hashOffset = GetUInt32(4);
+    uint32_t bucketCount = GetUInt32(hashOffset);
+    for (uint32_t bucket = 0; bucket < bucketCount; ++bucket) {
+        uint32_t chain = GetUInt32(hashOffset + 4 + 4 * bucket);
+        while (chain != 0xFFFFFFFF) {
+            const char* name = GetString(GetUInt32(chain + 4));
+            if (name == nullptr) break;
+            fn(name, GetImageList(GetUInt32(chain + 8)));
+            chain = GetUInt32(chain);
+        }
+    }
+}
+
+#endif //WXFDICONTHEME_GTKICONCACHE_H
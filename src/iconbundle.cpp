@@ -0,0 +1,90 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#include "iconbundle.h"
+
+IconBundleImpl::IconBundleImpl(const std::map<int, wxString>& files, std::shared_ptr<IconImageCache> cache) :
+    files(files.begin(), files.end()),
+    cache(std::move(cache))
+{
+}
+
+wxSize IconBundleImpl::GetDefaultSize() const {
+    return wxSize(files.front().first, files.front().first);
+}
+
+wxSize IconBundleImpl::GetPreferredBitmapSizeAtScale(double scale) const {
+    return DoGetPreferredSize(scale);
+}
+
+double IconBundleImpl::GetNextAvailableScale(size_t& i) const {
+    if (i >= files.size()) return 0;
+    return (double) files[i++].first / files.front().first;
+}
+
+wxBitmap IconBundleImpl::GetBitmap(const wxSize& size) {
+    auto key = std::make_pair(size.GetWidth(), size.GetHeight());
+    auto it = bitmaps.find(key);
+    if (it != bitmaps.end()) return it->second;
+
+    wxImage image = Decode(size);
+    wxBitmap bitmap = image.IsOk() ? wxBitmap(image) : wxBitmap();
+    bitmaps.emplace(key, bitmap);
+    return bitmap;
+}
+
+wxImage IconBundleImpl::Decode(const wxSize& size) const {
+    int pixelSize = std::max(size.GetWidth(), size.GetHeight());
+
+    // The exact size first, then an SVG file rendered at the size, then the closest bigger file.
+    const std::pair<int, wxString>* source = nullptr;
+    for (const auto& file : files) {
+        if (file.first == pixelSize) {
+            source = &file;
+            break;
+        }
+    }
+    if (source == nullptr) {
+        for (const auto& file : files) {
+            if (IconImageCache::IsSvg(file.second)) {
+                source = &file;
+                break;
+            }
+        }
+    }
+    if (source == nullptr) {
+        source = &files.back();
+        for (const auto& file : files) {
+            if (file.first >= pixelSize) {
+                source = &file;
+                break;
+            }
+        }
+    }
+
+    bool svg = IconImageCache::IsSvg(source->second);
+    wxImage image = cache->Load(source->second, svg ? pixelSize : source->first);
+    if (image.IsOk() && (image.GetWidth() != size.GetWidth() || image.GetHeight() != size.GetHeight())) {
+        image = image.Scale(size.GetWidth(), size.GetHeight(), wxIMAGE_QUALITY_HIGH);
+    }
+    return image;
+}
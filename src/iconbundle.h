@@ -0,0 +1,61 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#ifndef WXFDICONTHEME_ICONBUNDLE_H
+#define WXFDICONTHEME_ICONBUNDLE_H
+
+#include <wx/bmpbndl.h>
+#include <wx/string.h>
+
+#include <map>
+#include <memory>
+
+#include "iconimagecache.h"
+
+/**
+ * wxBitmapBundle implementation decoding icon files on demand.
+ *
+ * It only knows the files of the icon by pixel size: a bitmap is decoded the first time
+ * GetBitmap() asks for its size, then kept. Sizes without a file are rendered from an SVG file
+ * when there is one, or scaled from the closest bigger file. Main thread only, like any bundle.
+ */
+class IconBundleImpl : public wxBitmapBundleImpl {
+public:
+    IconBundleImpl(const std::map<int, wxString>& files, std::shared_ptr<IconImageCache> cache);
+
+    wxSize GetDefaultSize() const override;
+    wxSize GetPreferredBitmapSizeAtScale(double scale) const override;
+    wxBitmap GetBitmap(const wxSize& size) override;
+
+protected:
+    double GetNextAvailableScale(size_t& i) const override;
+
+private:
+    wxVector<std::pair<int, wxString>> files; // By increasing pixel size, not empty
+    std::shared_ptr<IconImageCache> cache;
+    std::map<std::pair<int, int>, wxBitmap> bitmaps; // Decoded so far, by size
+
+    wxImage Decode(const wxSize& size) const;
+};
+
+#endif //WXFDICONTHEME_ICONBUNDLE_H
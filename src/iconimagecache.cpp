@@ -0,0 +1,125 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#include "iconimagecache.h"
+#include "trace.h"
+
+#include <wx/filefn.h>
+#include <wx/imagpng.h>
+#include <wx/imagxpm.h>
+#include <wx/log.h>
+#include <wx/thread.h>
+
+IconImageCache::IconImageCache(size_t budget) : images(budget) {
+    // Icons are mostly PNG, make sure they can be decoded even if the application did not register handlers.
+    if (wxImage::FindHandler(wxBITMAP_TYPE_PNG) == nullptr) {
+        wxImage::AddHandler(new wxPNGHandler);
+    }
+    if (wxImage::FindHandler(wxBITMAP_TYPE_XPM) == nullptr) {
+        wxImage::AddHandler(new wxXPMHandler);
+    }
+}
+
+void IconImageCache::SetBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    images.SetCapacity(bytes);
+}
+
+size_t IconImageCache::GetBudget() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return images.GetCapacity();
+}
+
+size_t IconImageCache::GetSize() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return images.GetCost();
+}
+
+size_t IconImageCache::GetHits() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return images.GetHits();
+}
+
+size_t IconImageCache::GetMisses() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return images.GetMisses();
+}
+
+void IconImageCache::ResetCounters() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        images.ResetCounters();
+    }
+    decodedCount = 0;
+    decodedBytes = 0;
+}
+
+void IconImageCache::Clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    images.Clear();
+}
+
+size_t IconImageCache::GetImageSize(const wxImage& image) {
+    size_t pixels = (size_t) image.GetWidth() * image.GetHeight();
+    return pixels * (image.HasAlpha() ? 4 : 3);
+}
+
+wxImage IconImageCache::Load(const wxString& path, int pixelSize) {
+    bool svg = IsSvg(path);
+    if (svg && pixelSize <= 0) return wxImage();
+
+    wxStructStat st;
+    if (wxStat(path, &st) != 0) return wxImage();
+
+    wxString key = svg ? wxString::Format("%s@%d", path, pixelSize) : path;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const CachedImage* cached = images.Find(key);
+        if (cached != nullptr && cached->mtime == st.st_mtime) {
+            return cached->image.Copy();
+        }
+    }
+
+    TraceScope trace("IconImageCache::Decode");
+    wxImage image;
+    if (svg) {
+        image = rasterCache.Load(path, st.st_mtime, pixelSize);
+        if (!image.IsOk() && wxIsMainThread()) {
+            image = rasterCache.Render(path, st.st_mtime, pixelSize);
+        }
+        if (!image.IsOk()) return wxImage();
+    } else {
+        wxLogNull noLog;
+        if (!image.LoadFile(path, wxBITMAP_TYPE_ANY)) return wxImage();
+    }
+
+    size_t imageSize = GetImageSize(image);
+    ++decodedCount;
+    decodedBytes += imageSize;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (imageSize > images.GetCapacity()) return image;
+
+    wxImage result = image.Copy();
+    images.Insert(key, {st.st_mtime, std::move(image)}, imageSize);
+    return result;
+}
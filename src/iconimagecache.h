@@ -0,0 +1,94 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#ifndef WXFDICONTHEME_ICONIMAGECACHE_H
+#define WXFDICONTHEME_ICONIMAGECACHE_H
+
+#include <wx/image.h>
+#include <wx/hashmap.h>
+
+#include <atomic>
+#include <ctime>
+#include <mutex>
+
+#include "lrucache.h"
+#include "svgrastercache.h"
+
+/**
+ * Decoded icon images, keyed by file path and modification time,
+ * bounded by a memory budget with LRU eviction.
+ *
+ * Images are decoded outside of the lock, so loads may run concurrently.
+ * As wxImage reference counting is not atomic, returned images never share
+ * their data with the cached ones and can be used from any thread.
+ */
+class IconImageCache {
+public:
+    static constexpr size_t DEFAULT_BUDGET = 32 * 1024 * 1024;
+
+    explicit IconImageCache(size_t budget = DEFAULT_BUDGET);
+
+    /** Memory budget in bytes, 0 disables caching. */
+    void SetBudget(size_t bytes);
+    size_t GetBudget() const;
+    size_t GetSize() const;
+    size_t GetHits() const;
+    size_t GetMisses() const;
+
+    /** Images decoded from files or the raster cache, and the memory of their data. */
+    size_t GetDecodedCount() const { return decodedCount; }
+    size_t GetDecodedBytes() const { return decodedBytes; }
+
+    /** Reset hits, misses and decoding counters. */
+    void ResetCounters();
+
+    /**
+     * Decoded image of the file, invalid if it cannot be read.
+     * SVG files are rasterized at pixelSize, through the raster cache. Rendering a size for the first time
+     * only happens on the main thread, other threads get an invalid image until then.
+     */
+    wxImage Load(const wxString& path, int pixelSize = 0);
+
+    SvgRasterCache& GetRasterCache() { return rasterCache; }
+
+    static bool IsSvg(const wxString& path) { return path.EndsWith(".svg"); }
+
+    void Clear();
+
+    /** Memory used by the decoded image data. */
+    static size_t GetImageSize(const wxImage& image);
+
+private:
+    struct CachedImage {
+        time_t mtime;
+        wxImage image;
+    };
+
+    mutable std::mutex mutex;
+    LruCache<wxString, CachedImage, wxStringHash> images; // By path, and pixel size for SVG files
+    SvgRasterCache rasterCache;
+    std::atomic<size_t> decodedCount{0};
+    std::atomic<size_t> decodedBytes{0};
+};
+
+#endif //WXFDICONTHEME_ICONIMAGECACHE_H
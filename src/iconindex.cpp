@@ -0,0 +1,131 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#include "iconindex.h"
+
+#include <algorithm>
+#include <cstring>
+
+const char* IconIndex::GetExtension(Extension ext) {
+    switch (ext) {
+        case EXT_XPM: return ".xpm";
+        case EXT_SVG: return ".svg";
+        default:      return ".png";
+    }
+}
+
+bool IconIndex::ParseFileName(const wxString& fileName, wxString& iconName, Extension& ext) {
+    for (int i = 0; i < EXT_COUNT; ++i) {
+        if (fileName.EndsWith(GetExtension((Extension) i), &iconName) && !iconName.IsEmpty()) {
+            ext = (Extension) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void IconIndex::Clear() {
+    strings.clear();
+    nameOffsets.clear();
+    entryOffsets.clear();
+    entries.clear();
+    table.clear();
+    pending.clear();
+}
+
+uint32_t IconIndex::Hash(const char* name) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (const char* p = name; *p != '\0'; ++p) {
+        hash = (hash ^ (unsigned char) *p) * 16777619u;
+    }
+    return hash;
+}
+
+uint32_t IconIndex::Find(const char* iconName) const {
+    if (table.empty()) return npos;
+    size_t mask = table.size() - 1;
+    for (size_t slot = Hash(iconName) & mask; table[slot] != 0; slot = (slot + 1) & mask) {
+        uint32_t icon = table[slot] - 1;
+        if (std::strcmp(GetName(icon), iconName) == 0) return icon;
+    }
+    return npos;
+}
+
+void IconIndex::Rehash(size_t size) {
+    table.assign(size, 0);
+    size_t mask = size - 1;
+    for (uint32_t icon = 0; icon < nameOffsets.size(); ++icon) {
+        size_t slot = Hash(GetName(icon)) & mask;
+        while (table[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        table[slot] = icon + 1;
+    }
+}
+
+uint32_t IconIndex::Intern(const char* name) {
+    // Keep the load factor under 1/2
+    if ((nameOffsets.size() + 1) * 2 > table.size()) {
+        Rehash(std::max<size_t>(64, table.size() * 2));
+    }
+
+    size_t mask = table.size() - 1;
+    size_t slot = Hash(name) & mask;
+    for (; table[slot] != 0; slot = (slot + 1) & mask) {
+        uint32_t icon = table[slot] - 1;
+        if (std::strcmp(GetName(icon), name) == 0) return icon;
+    }
+
+    uint32_t icon = nameOffsets.size();
+    nameOffsets.push_back(strings.size());
+    strings.insert(strings.end(), name, name + std::strlen(name) + 1);
+    table[slot] = icon + 1;
+    return icon;
+}
+
+void IconIndex::Add(const wxString& iconName, uint16_t directory, Extension ext) {
+    uint32_t icon = Intern(iconName.utf8_str());
+    pending.push_back({icon, {directory, ext}});
+}
+
+void IconIndex::Finish() {
+    // Counting sort of the pending entries by icon, stable to keep directory order.
+    entryOffsets.assign(nameOffsets.size() + 1, 0);
+    for (const auto& [icon, _] : pending) {
+        ++entryOffsets[icon + 1];
+    }
+    for (size_t i = 1; i < entryOffsets.size(); ++i) {
+        entryOffsets[i] += entryOffsets[i - 1];
+    }
+
+    entries.resize(pending.size());
+    std::vector<uint32_t> next(entryOffsets.begin(), entryOffsets.end() - 1);
+    for (const auto& [icon, entry] : pending) {
+        entries[next[icon]++] = entry;
+    }
+
+    pending.clear();
+    pending.shrink_to_fit();
+    strings.shrink_to_fit();
+    nameOffsets.shrink_to_fit();
+}
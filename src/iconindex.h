@@ -0,0 +1,103 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#ifndef WXFDICONTHEME_ICONINDEX_H
+#define WXFDICONTHEME_ICONINDEX_H
+
+#include <wx/string.h>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * Compact index of the icon files of a theme.
+ *
+ * Icon names are interned once in a string table, and an open-addressing
+ * hash table maps them to a small array of (directory, extension) entries.
+ * File paths are not stored, they are rebuilt from the theme directories.
+ */
+class IconIndex {
+public:
+    // In lookup preference order, as in the Icon Theme Specification.
+    enum Extension : uint8_t {
+        EXT_PNG,
+        EXT_SVG,
+        EXT_XPM
+    };
+    static constexpr int EXT_COUNT = 3;
+
+    struct Entry {
+        uint16_t directory; // Index in the theme directories
+        Extension extension;
+    };
+
+    static constexpr uint32_t npos = 0xFFFFFFFF;
+
+    static const char* GetExtension(Extension ext);
+    /** Split an icon file name into icon name and extension, false if it is not an icon file. */
+    static bool ParseFileName(const wxString& fileName, wxString& iconName, Extension& ext);
+
+    void Clear();
+
+    /**
+     * Add a file. Files must be added directory by directory, in theme order,
+     * entries of an icon keep this order.
+     */
+    void Add(const wxString& iconName, uint16_t directory, Extension ext);
+    /** Finalize the index after the last Add(). */
+    void Finish();
+
+    bool IsEmpty() const { return nameOffsets.empty(); }
+    uint32_t GetIconCount() const { return nameOffsets.size(); }
+
+    /** Icon id of the given UTF-8 name, or npos. */
+    uint32_t Find(const char* iconName) const;
+
+    const char* GetName(uint32_t icon) const { return strings.data() + nameOffsets[icon]; }
+    std::span<const Entry> GetEntries(uint32_t icon) const {
+        return {entries.data() + entryOffsets[icon], entries.data() + entryOffsets[icon + 1]};
+    }
+
+    std::span<const Entry> FindEntries(const char* iconName) const {
+        uint32_t icon = Find(iconName);
+        if (icon == npos) return {};
+        return GetEntries(icon);
+    }
+
+private:
+    std::vector<char> strings;           // NUL terminated UTF-8 names
+    std::vector<uint32_t> nameOffsets;   // Icon id -> offset in strings
+    std::vector<uint32_t> entryOffsets;  // Icon id -> first entry, plus one past the end
+    std::vector<Entry> entries;          // Grouped by icon id
+    std::vector<uint32_t> table;         // Open addressing, icon id + 1 or 0 when free
+
+    // Entries being added, grouped by icon in Finish()
+    std::vector<std::pair<uint32_t, Entry>> pending;
+
+    static uint32_t Hash(const char* name);
+    uint32_t Intern(const char* name);
+    void Rehash(size_t size);
+};
+
+#endif //WXFDICONTHEME_ICONINDEX_H
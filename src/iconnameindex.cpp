@@ -0,0 +1,139 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#include "iconnameindex.h"
+
+#include <algorithm>
+#include <cstring>
+
+IconNameIndex::IconNameIndex(wxVector<wxString> allNames) {
+    for (const auto& name : allNames) {
+        utf8Names.push_back(std::string(name.utf8_str()));
+    }
+    std::sort(utf8Names.begin(), utf8Names.end());
+    utf8Names.erase(std::unique(utf8Names.begin(), utf8Names.end()), utf8Names.end());
+    for (const auto& name : utf8Names) {
+        names.push_back(wxString::FromUTF8(name.c_str()));
+    }
+
+    // Postings are built sorted by trigram then name id, so each list is ordered like the names.
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    for (uint32_t id = 0; id < utf8Names.size(); ++id) {
+        const std::string& name = utf8Names[id];
+        for (size_t i = 0; i + 3 <= name.size(); ++i) {
+            pairs.push_back({Trigram(name.data() + i), id});
+        }
+    }
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+    for (const auto& [trigram, id] : pairs) {
+        if (trigramKeys.empty() || trigramKeys.back() != trigram) {
+            trigramKeys.push_back(trigram);
+            trigramOffsets.push_back(postings.size());
+        }
+        postings.push_back(id);
+    }
+    trigramOffsets.push_back(postings.size());
+}
+
+bool IconNameIndex::Matches(const char* name, const char* pattern) {
+    // Iterative, backtracking to the last star only.
+    const char* star = nullptr;
+    const char* resume = nullptr;
+    while (*name != '\0') {
+        if (*pattern == '*') {
+            star = pattern++;
+            resume = name;
+        } else if (*pattern == '?' || *pattern == *name) {
+            ++pattern;
+            ++name;
+        } else if (star != nullptr) {
+            pattern = star + 1;
+            name = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (*pattern == '*') {
+        ++pattern;
+    }
+    return *pattern == '\0';
+}
+
+wxVector<wxString> IconNameIndex::Search(const wxString& query, size_t limit) const {
+    wxVector<wxString> results;
+    std::string pattern(query.utf8_str());
+    if (pattern.find_first_of("*?") == std::string::npos) {
+        pattern = "*" + pattern + "*";
+    }
+    auto accept = [&](uint32_t id) {
+        if (Matches(utf8Names[id].c_str(), pattern.c_str())) {
+            results.push_back(names[id]);
+        }
+        return limit == 0 || results.size() < limit;
+    };
+
+    // Anchored pattern: the names starting with its literal prefix are contiguous.
+    size_t prefixLength = pattern.find_first_of("*?");
+    if (prefixLength > 0) {
+        std::string prefix = pattern.substr(0, prefixLength);
+        auto it = std::lower_bound(utf8Names.begin(), utf8Names.end(), prefix);
+        for (; it != utf8Names.end() && it->compare(0, prefix.size(), prefix) == 0; ++it) {
+            if (!accept(it - utf8Names.begin())) break;
+        }
+        return results;
+    }
+
+    // Otherwise, only the names containing the rarest trigram of the literal parts are candidates.
+    const uint32_t* first = nullptr;
+    const uint32_t* last = nullptr;
+    size_t start = 0;
+    while (start < pattern.size()) {
+        size_t end = pattern.find_first_of("*?", start);
+        if (end == std::string::npos) end = pattern.size();
+        for (size_t i = start; i + 3 <= end; ++i) {
+            auto key = std::lower_bound(trigramKeys.begin(), trigramKeys.end(), Trigram(pattern.data() + i));
+            if (key == trigramKeys.end() || *key != Trigram(pattern.data() + i)) {
+                return results; // No name contains it
+            }
+            size_t k = key - trigramKeys.begin();
+            if (first == nullptr || trigramOffsets[k + 1] - trigramOffsets[k] < (size_t) (last - first)) {
+                first = postings.data() + trigramOffsets[k];
+                last = postings.data() + trigramOffsets[k + 1];
+            }
+        }
+        start = end + 1;
+    }
+
+    if (first != nullptr) {
+        for (const uint32_t* id = first; id != last; ++id) {
+            if (!accept(*id)) break;
+        }
+    } else {
+        // Literal parts too short for trigrams.
+        for (uint32_t id = 0; id < utf8Names.size(); ++id) {
+            if (!accept(id)) break;
+        }
+    }
+    return results;
+}
@@ -0,0 +1,72 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#ifndef WXFDICONTHEME_ICONNAMEINDEX_H
+#define WXFDICONTHEME_ICONNAMEINDEX_H
+
+#include <wx/string.h>
+#include <wx/vector.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Sorted and deduplicated icon names, searchable by substring or wildcard pattern.
+ *
+ * Patterns not starting with a wildcard are resolved by binary search on their prefix.
+ * Others go through a trigram index: only the names containing the rarest trigram
+ * of the pattern are matched. Names are compared as UTF-8 bytes.
+ */
+class IconNameIndex {
+public:
+    explicit IconNameIndex(wxVector<wxString> names);
+
+    size_t GetCount() const { return names.size(); }
+    const wxString& GetName(size_t i) const { return names[i]; }
+
+    /**
+     * Names matching the query, in order, at most limit of them (0 for all).
+     * The query is a pattern with * and ? wildcards, like "*-symbolic", or else a substring, like "folder".
+     */
+    wxVector<wxString> Search(const wxString& query, size_t limit = 0) const;
+
+    /** Glob matching of UTF-8 strings, * matching any sequence and ? any byte. */
+    static bool Matches(const char* name, const char* pattern);
+
+private:
+    wxVector<wxString> names;
+    std::vector<std::string> utf8Names;
+
+    // Trigram -> ids of the names containing it, flattened: ids of trigramKeys[i]
+    // are postings[trigramOffsets[i]] to postings[trigramOffsets[i + 1]].
+    std::vector<uint32_t> trigramKeys;
+    std::vector<uint32_t> trigramOffsets;
+    std::vector<uint32_t> postings;
+
+    static uint32_t Trigram(const char* p) {
+        return ((uint32_t) (unsigned char) p[0] << 16) | ((uint32_t) (unsigned char) p[1] << 8) | (unsigned char) p[2];
+    }
+};
+
+#endif //WXFDICONTHEME_ICONNAMEINDEX_H
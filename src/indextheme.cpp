@@ -0,0 +1,193 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#include "indextheme.h"
+#include "cacheutil.h"
+
+#include <wx/file.h>
+#include <wx/log.h>
+
+#include <algorithm>
+#include <charconv>
+
+namespace {
+
+// Written by some editors on Windows, skipped by wxFileConfig too.
+constexpr std::string_view UTF8_BOM = "\xEF\xBB\xBF";
+
+char ToLowerAscii(char c) {
+    return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+// Check the complete lines of text from scanned on, true once a group header follows the group.
+bool PassedGroup(std::string_view text, size_t& scanned, std::string_view group, bool& seen) {
+    if (scanned == 0 && text.starts_with(UTF8_BOM)) scanned = UTF8_BOM.size();
+    for (size_t end = text.find('\n', scanned); end != std::string_view::npos; end = text.find('\n', scanned)) {
+        std::string_view line = IndexThemeFile::Trim(text.substr(scanned, end - scanned));
+        scanned = end + 1;
+        size_t close = line.find(']');
+        if (line.empty() || line[0] != '[' || close == std::string_view::npos) continue;
+        if (IndexThemeFile::EqualsNoCase(line.substr(1, close - 1), group)) {
+            seen = true;
+        } else if (seen) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+bool IndexThemeFile::Load(const wxString& path, std::string_view onlyGroup) {
+    wxLogNull noLog;
+    wxFile file(path);
+    if (!file.IsOpened()) return false;
+
+    std::string text;
+    if (onlyGroup.empty()) {
+        wxFileOffset length = file.Length();
+        if (length == wxInvalidOffset) return false;
+        text.resize(length);
+        if (file.Read(text.data(), text.size()) != (ssize_t) text.size()) return false;
+    } else {
+        // By blocks, up to the one holding the next group header.
+        constexpr size_t BLOCK_SIZE = 4096;
+        size_t scanned = 0;
+        bool seen = false;
+        for (;;) {
+            size_t size = text.size();
+            text.resize(size + BLOCK_SIZE);
+            ssize_t read = file.Read(text.data() + size, BLOCK_SIZE);
+            if (read == wxInvalidOffset) return false;
+            text.resize(size + read);
+            if (read == 0 || PassedGroup(text, scanned, onlyGroup, seen)) break;
+        }
+    }
+
+    Parse(std::move(text), onlyGroup);
+    return true;
+}
+
+void IndexThemeFile::Parse(std::string text, std::string_view onlyGroup) {
+    content = std::move(text);
+    groups.clear();
+
+    std::string_view rest(content);
+    if (rest.starts_with(UTF8_BOM)) rest.remove_prefix(UTF8_BOM.size());
+    std::vector<std::pair<std::string_view, std::string_view>>* group = nullptr;
+    bool seen = false;
+    while (!rest.empty()) {
+        size_t end = rest.find('\n');
+        std::string_view line = Trim(rest.substr(0, end));
+        rest = end == std::string_view::npos ? std::string_view() : rest.substr(end + 1);
+
+        if (line.empty() || line[0] == '#' || line[0] == ';') continue;
+
+        if (line[0] == '[') {
+            size_t close = line.find(']');
+            if (close == std::string_view::npos) continue;
+            std::string_view name = line.substr(1, close - 1);
+            if (!onlyGroup.empty() && !EqualsNoCase(name, onlyGroup)) {
+                if (seen) return;
+                group = nullptr;
+                continue;
+            }
+            seen = true;
+            group = &groups[name];
+            continue;
+        }
+
+        size_t equal = line.find('=');
+        if (group == nullptr || equal == std::string_view::npos) continue;
+        std::string_view key = Trim(line.substr(0, equal));
+        std::string_view value = Trim(line.substr(equal + 1));
+        auto existing = std::find_if(group->begin(), group->end(), [&](const auto& entry) { return EqualsNoCase(entry.first, key); });
+        if (existing != group->end()) {
+            existing->second = value;
+        } else {
+            group->push_back({key, value});
+        }
+    }
+}
+
+std::optional<std::string_view> IndexThemeFile::GetValue(std::string_view group, std::string_view key) const {
+    auto it = groups.find(group);
+    if (it == groups.end()) return std::nullopt;
+    for (const auto& [entryKey, value] : it->second) {
+        if (EqualsNoCase(entryKey, key)) return value;
+    }
+    return std::nullopt;
+}
+
+wxString IndexThemeFile::GetString(std::string_view group, std::string_view key, const wxString& defaultValue) const {
+    auto value = GetValue(group, key);
+    if (!value) return defaultValue;
+    return wxString::FromUTF8(value->data(), value->size());
+}
+
+int IndexThemeFile::GetInt(std::string_view group, std::string_view key, int defaultValue) const {
+    auto value = GetValue(group, key);
+    if (!value) return defaultValue;
+    std::string_view number = *value;
+    if (!number.empty() && number[0] == '+') number.remove_prefix(1);
+    int result;
+    auto [end, error] = std::from_chars(number.data(), number.data() + number.size(), result);
+    if (error != std::errc() || end != number.data() + number.size()) return defaultValue;
+    return result;
+}
+
+std::vector<std::string_view> IndexThemeFile::SplitList(std::string_view list) {
+    std::vector<std::string_view> items;
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        std::string_view item = Trim(list.substr(0, comma));
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+        list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+    }
+    return items;
+}
+
+std::string_view IndexThemeFile::Trim(std::string_view text) {
+    const char* spaces = " \t\r";
+    size_t first = text.find_first_not_of(spaces);
+    if (first == std::string_view::npos) return {};
+    size_t last = text.find_last_not_of(spaces);
+    return text.substr(first, last - first + 1);
+}
+
+bool IndexThemeFile::EqualsNoCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (ToLowerAscii(a[i]) != ToLowerAscii(b[i])) return false;
+    }
+    return true;
+}
+
+size_t IndexThemeFile::NoCaseHash::operator()(std::string_view text) const {
+    uint64_t hash = FNV1A_OFFSET;
+    for (char c : text) {
+        hash = Fnv1a(hash, (unsigned char) ToLowerAscii(c));
+    }
+    return hash;
+}
@@ -0,0 +1,87 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#ifndef WXFDICONTHEME_INDEXTHEME_H
+#define WXFDICONTHEME_INDEXTHEME_H
+
+#include <wx/string.h>
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Single pass parser for the INI subset of index.theme files.
+ *
+ * Unlike wxFileConfig, no tree is built and nothing is converted: groups and values are views
+ * into the file content, which the parser owns. Keys and values are trimmed, comments (# and ;)
+ * and malformed lines ignored. Keys repeated in a group keep their last value.
+ *
+ * Like wxFileConfig, group and key names are case insensitive (ASCII only). Unlike it, values are
+ * taken as is: no quote or backslash unescaping, nor environment variable expansion. Groups are
+ * only the ones declared, while wxFileConfig also has the parents of "a/b" groups.
+ */
+class IndexThemeFile {
+public:
+    IndexThemeFile() = default;
+    // Parsed views point into the content
+    IndexThemeFile(const IndexThemeFile&) = delete;
+    IndexThemeFile& operator=(const IndexThemeFile&) = delete;
+
+    /**
+     * Read and parse the file. With onlyGroup, the other groups are skipped and the file is read
+     * by blocks, stopping with the one where the next group begins.
+     */
+    bool Load(const wxString& path, std::string_view onlyGroup = {});
+    void Parse(std::string text, std::string_view onlyGroup = {});
+
+    bool HasGroup(std::string_view group) const { return groups.count(group) != 0; }
+    std::optional<std::string_view> GetValue(std::string_view group, std::string_view key) const;
+
+    wxString GetString(std::string_view group, std::string_view key, const wxString& defaultValue = wxString()) const;
+    int GetInt(std::string_view group, std::string_view key, int defaultValue) const;
+
+    /** Comma separated list, trimmed items, empty ones skipped. */
+    static std::vector<std::string_view> SplitList(std::string_view list);
+
+    static std::string_view Trim(std::string_view text);
+
+    /** ASCII case insensitive comparison, used for group and key names. */
+    static bool EqualsNoCase(std::string_view a, std::string_view b);
+
+private:
+    struct NoCaseHash {
+        size_t operator()(std::string_view text) const;
+    };
+    struct NoCaseEqual {
+        bool operator()(std::string_view a, std::string_view b) const { return EqualsNoCase(a, b); }
+    };
+
+    std::string content;
+    std::unordered_map<std::string_view, std::vector<std::pair<std::string_view, std::string_view>>, NoCaseHash, NoCaseEqual> groups;
+};
+
+#endif //WXFDICONTHEME_INDEXTHEME_H
@@ -0,0 +1,114 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#ifndef WXFDICONTHEME_LRUCACHE_H
+#define WXFDICONTHEME_LRUCACHE_H
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+
+/**
+ * Least recently used cache bounded by the total cost of its values.
+ * With a cost of 1 per value, the capacity is a number of entries.
+ * Not thread-safe.
+ */
+template<typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+public:
+    explicit LruCache(size_t capacity = 0) : capacity(capacity) {}
+
+    size_t GetCapacity() const { return capacity; }
+    /** Evicts values as needed, 0 disables the cache. */
+    void SetCapacity(size_t newCapacity) {
+        capacity = newCapacity;
+        Evict();
+    }
+
+    size_t GetCount() const { return map.size(); }
+    size_t GetCost() const { return cost; }
+    size_t GetHits() const { return hits; }
+    size_t GetMisses() const { return misses; }
+    void ResetCounters() { hits = misses = 0; }
+
+    /** Value for the key, marked as most recently used, or nullptr. */
+    const Value* Find(const Key& key) {
+        auto it = map.find(key);
+        if (it == map.end()) {
+            ++misses;
+            return nullptr;
+        }
+        ++hits;
+        items.splice(items.begin(), items, it->second);
+        return &it->second->value;
+    }
+
+    void Insert(const Key& key, Value value, size_t valueCost = 1) {
+        Erase(key);
+        if (valueCost > capacity) return;
+        items.push_front({key, std::move(value), valueCost});
+        map.emplace(key, items.begin());
+        cost += valueCost;
+        Evict();
+    }
+
+    void Erase(const Key& key) {
+        auto it = map.find(key);
+        if (it != map.end()) {
+            cost -= it->second->cost;
+            items.erase(it->second);
+            map.erase(it);
+        }
+    }
+
+    void Clear() {
+        items.clear();
+        map.clear();
+        cost = 0;
+    }
+
+private:
+    struct Item {
+        Key key;
+        Value value;
+        size_t cost;
+    };
+
+    std::list<Item> items; // Most recently used first
+    std::unordered_map<Key, typename std::list<Item>::iterator, Hash> map;
+    size_t capacity;
+    size_t cost = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+
+    void Evict() {
+        while (cost > capacity && !items.empty()) {
+            cost -= items.back().cost;
+            map.erase(items.back().key);
+            items.pop_back();
+        }
+    }
+};
+
+#endif //WXFDICONTHEME_LRUCACHE_H
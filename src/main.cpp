@@ -345,22 +345,22 @@ private:
         auto gridSizer = new wxWrapSizer(wxHORIZONTAL);
 
         // Obtenir tous les noms d'icônes du thème
-        auto iconNames = GetIconNamesFromTheme(themeName);
+        auto nameSet = GetIconNamesFromTheme(themeName);
+        std::vector<wxString> iconNames(nameSet.begin(), nameSet.end());
+        auto iconFiles = iconProvider.FindIcons(themeName, iconNames, iconSize);
 
-        for (const auto& iconName : iconNames) {
-
-            auto iconFile = iconProvider.FindIcon(themeName, iconName, iconSize);
+        for (size_t i = 0; i < iconNames.size(); ++i) {
+            const auto& iconName = iconNames[i];
+            const auto& iconFile = iconFiles[i];
             if (iconFile) {
-                wxBitmap bitmap(iconFile->GetFullPath(), wxBITMAP_TYPE_ANY);
-                if (bitmap.IsOk()) {
+                wxImage image = iconProvider.GetImageCache()->Load(iconFile->GetFullPath(), iconSize);
+                if (image.IsOk()) {
                     // Redimensionner si nécessaire
-                    if (bitmap.GetWidth() != iconSize || bitmap.GetHeight() != iconSize) {
-                        wxImage image = bitmap.ConvertToImage();
+                    if (image.GetWidth() != iconSize || image.GetHeight() != iconSize) {
                         image = image.Scale(iconSize, iconSize, wxIMAGE_QUALITY_HIGH);
-                        bitmap = wxBitmap(image);
                     }
 
-                    store->AddIcon(iconName, bitmap);
+                    store->AddIcon(iconName, wxBitmap(image));
                 }
             }
         }
@@ -0,0 +1,76 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#ifndef WXFDICONTHEME_SLOTCACHE_H
+#define WXFDICONTHEME_SLOTCACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * Fixed-size, direct-mapped cache, read and written from any number of threads without locking.
+ * A key only ever lives in the slot its hash selects: inserting replaces whatever shares the slot,
+ * and a hit changes nothing. No recency is tracked, so colliding keys evict each other.
+ */
+template<typename Key, typename Value, typename Hash = std::hash<Key>>
+class SlotCache {
+public:
+    struct Entry {
+        Key key;
+        Value value;
+    };
+
+    explicit SlotCache(size_t capacity = 0) : slots(capacity) {}
+
+    SlotCache(const SlotCache&) = delete;
+    SlotCache& operator=(const SlotCache&) = delete;
+
+    size_t GetCapacity() const { return slots.size(); }
+    /** Occupied slots. */
+    size_t GetCount() const { return count.load(std::memory_order_relaxed); }
+
+    /** Entry of the key, or nullptr. Kept alive by the returned pointer, even if replaced meanwhile. */
+    std::shared_ptr<const Entry> Find(const Key& key) const {
+        if (slots.empty()) return nullptr;
+        auto entry = slots[Hash()(key) % slots.size()].load(std::memory_order_acquire);
+        if (!entry || !(entry->key == key)) return nullptr;
+        return entry;
+    }
+
+    void Insert(const Key& key, Value value) {
+        if (slots.empty()) return;
+        auto entry = std::make_shared<const Entry>(Entry{key, std::move(value)});
+        if (!slots[Hash()(key) % slots.size()].exchange(std::move(entry), std::memory_order_acq_rel)) {
+            count.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    std::vector<std::atomic<std::shared_ptr<const Entry>>> slots;
+    std::atomic<size_t> count{0};
+};
+
+#endif //WXFDICONTHEME_SLOTCACHE_H
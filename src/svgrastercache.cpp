@@ -0,0 +1,147 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#include "svgrastercache.h"
+#include "cacheutil.h"
+
+#include <wx/bmpbndl.h>
+#include <wx/dir.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+#include <wx/log.h>
+#include <wx/utils.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// Shared by the files of an SVG at a pixel size, whatever its modification time.
+wxString GetFilePrefix(const wxString& svgPath, int pixelSize) {
+    wxString key = wxString::Format("%s\n%d", svgPath, pixelSize);
+    return wxString::Format("%016llx-", (unsigned long long) HashUtf8(key));
+}
+
+int64_t GetFileSize(const wxString& path) {
+    wxStructStat st;
+    if (wxStat(path, &st) != 0) return 0;
+    return st.st_size;
+}
+
+} // namespace
+
+SvgRasterCache::SvgRasterCache(const wxString& directory) : directory(directory) {}
+
+wxString SvgRasterCache::GetDefaultDirectory() {
+    return wxFileName(GetUserCacheDirectory(), "svg").GetFullPath();
+}
+
+wxString SvgRasterCache::GetCacheFile(const wxString& svgPath, time_t mtime, int pixelSize) const {
+    wxString name = GetFilePrefix(svgPath, pixelSize) + wxString::Format("%lld.png", (long long) mtime);
+    return wxFileName(directory, name).GetFullPath();
+}
+
+wxImage SvgRasterCache::Load(const wxString& svgPath, time_t mtime, int pixelSize) const {
+    wxImage image;
+    if (directory.IsEmpty()) return image;
+
+    wxString cacheFile = GetCacheFile(svgPath, mtime, pixelSize);
+    if (!wxFileExists(cacheFile)) return image;
+
+    wxLogNull noLog;
+    image.LoadFile(cacheFile, wxBITMAP_TYPE_PNG);
+    return image;
+}
+
+wxImage SvgRasterCache::Render(const wxString& svgPath, time_t mtime, int pixelSize) const {
+    wxSize size(pixelSize, pixelSize);
+    wxImage image;
+    {
+        wxLogNull noLog;
+        wxBitmapBundle bundle = wxBitmapBundle::FromSVGFile(svgPath, size);
+        if (!bundle.IsOk()) return image;
+        image = bundle.GetBitmap(size).ConvertToImage();
+    }
+    if (!image.IsOk() || directory.IsEmpty()) return image;
+
+    // Written aside then renamed, so concurrent processes never read a partial file.
+    wxLogNull noLog;
+    if (!wxFileName::Mkdir(directory, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL)) return image;
+    wxString cacheFile = GetCacheFile(svgPath, mtime, pixelSize);
+    wxString tempFile = wxString::Format("%s.%lu.tmp", cacheFile, wxGetProcessId());
+    if (!image.SaveFile(tempFile, wxBITMAP_TYPE_PNG) || !wxRenameFile(tempFile, cacheFile)) {
+        wxRemoveFile(tempFile);
+        return image;
+    }
+
+    // Renderings of previous versions of the SVG are never loaded again.
+    int64_t added = GetFileSize(cacheFile);
+    wxVector<wxString> stale;
+    wxString name;
+    wxDir dir(directory);
+    for (bool cont = dir.GetFirst(&name, GetFilePrefix(svgPath, pixelSize) + "*.png", wxDIR_FILES); cont; cont = dir.GetNext(&name)) {
+        wxString file = wxFileName(directory, name).GetFullPath();
+        if (file != cacheFile) stale.push_back(file);
+    }
+    for (const auto& file : stale) {
+        int64_t size = GetFileSize(file);
+        if (wxRemoveFile(file)) added -= size;
+    }
+    Prune(added);
+    return image;
+}
+
+void SvgRasterCache::Prune(int64_t added) const {
+    if (sizeLimit == 0) return;
+    if (usedBytes >= 0) {
+        usedBytes += added;
+        if (usedBytes <= (int64_t) sizeLimit) return;
+    }
+
+    // First store, or over the limit: list the directory, other processes write to it too.
+    struct File {
+        time_t mtime;
+        int64_t size;
+        wxString path;
+    };
+    std::vector<File> files;
+    int64_t total = 0;
+    wxString name;
+    wxDir dir(directory);
+    for (bool cont = dir.GetFirst(&name, "*.png", wxDIR_FILES); cont; cont = dir.GetNext(&name)) {
+        wxString path = wxFileName(directory, name).GetFullPath();
+        wxStructStat st;
+        if (wxStat(path, &st) != 0) continue;
+        files.push_back({st.st_mtime, st.st_size, path});
+        total += st.st_size;
+    }
+
+    if (total > (int64_t) sizeLimit) {
+        // Down to three quarters of the limit, so the next stores don't prune again.
+        std::sort(files.begin(), files.end(), [](const File& a, const File& b) { return a.mtime < b.mtime; });
+        for (const auto& file : files) {
+            if (total <= (int64_t) (sizeLimit / 4 * 3)) break;
+            if (wxRemoveFile(file.path)) total -= file.size;
+        }
+    }
+    usedBytes = total;
+}
@@ -0,0 +1,76 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#ifndef WXFDICONTHEME_SVGRASTERCACHE_H
+#define WXFDICONTHEME_SVGRASTERCACHE_H
+
+#include <wx/image.h>
+#include <wx/string.h>
+
+#include <cstdint>
+#include <ctime>
+
+/**
+ * Rasterizations of SVG icons, stored as PNG files so each size is rendered once.
+ *
+ * Files are named after a hash of the SVG path and the pixel size (size * scale), followed by the
+ * modification time of the SVG: storing the rendering of an edited SVG removes the older ones.
+ * The directory is also kept under a size limit, removing the files written first.
+ */
+class SvgRasterCache {
+public:
+    static constexpr size_t DEFAULT_SIZE_LIMIT = 64 * 1024 * 1024;
+
+    explicit SvgRasterCache(const wxString& directory = GetDefaultDirectory());
+
+    /** $XDG_CACHE_HOME/wxFDIconTheme/svg, or ~/.cache/wxFDIconTheme/svg */
+    static wxString GetDefaultDirectory();
+
+    /** Where rasterizations are stored, empty to render them every time. To set before use. */
+    void SetDirectory(const wxString& dir) { directory = dir; }
+    const wxString& GetDirectory() const { return directory; }
+
+    /** Bytes the directory may hold, 0 for no limit. To set before use. */
+    void SetSizeLimit(size_t bytes) { sizeLimit = bytes; }
+    size_t GetSizeLimit() const { return sizeLimit; }
+
+    /** Stored rasterization, invalid if not rendered yet. Can be called from any thread. */
+    wxImage Load(const wxString& svgPath, time_t mtime, int pixelSize) const;
+
+    /**
+     * Render the SVG file at the pixel size and store the result.
+     * Main thread only, as wxBitmapBundle rasterizes into a wxBitmap.
+     */
+    wxImage Render(const wxString& svgPath, time_t mtime, int pixelSize) const;
+
+private:
+    wxString directory;
+    size_t sizeLimit = DEFAULT_SIZE_LIMIT;
+    mutable int64_t usedBytes = -1; // By the directory, unknown until the first store lists it
+
+    wxString GetCacheFile(const wxString& svgPath, time_t mtime, int pixelSize) const;
+    /** Account for stored bytes, removing the oldest files once over the limit. */
+    void Prune(int64_t added) const;
+};
+
+#endif //WXFDICONTHEME_SVGRASTERCACHE_H
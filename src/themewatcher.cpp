@@ -0,0 +1,217 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#include "themewatcher.h"
+#include "fdicontheme.h"
+
+#ifdef __LINUX__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#endif
+
+#ifdef __LINUX__
+
+namespace {
+
+constexpr uint32_t DIRECTORY_EVENTS = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+// index.theme is usually replaced by a rename, rather than written in place.
+constexpr uint32_t THEME_EVENTS = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+// Added to the mask of a parent of missing directories, which may already be watched.
+constexpr uint32_t ANCESTOR_EVENTS = IN_CREATE | IN_MOVED_TO | IN_ONLYDIR | IN_MASK_ADD;
+
+} // namespace
+
+ThemeWatcher::ThemeWatcher(ChangeCallback callback) : callback(std::move(callback)) {
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return;
+    stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (stopFd < 0) {
+        close(fd);
+        fd = -1;
+        return;
+    }
+    thread = std::thread([this]() { Run(); });
+}
+
+ThemeWatcher::~ThemeWatcher() {
+    if (thread.joinable()) {
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t written = write(stopFd, &one, sizeof(one));
+        thread.join();
+    }
+    if (stopFd >= 0) close(stopFd);
+    if (fd >= 0) close(fd);
+}
+
+void ThemeWatcher::Watch(const std::shared_ptr<const IconTheme>& theme) {
+    if (fd < 0 || !theme) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto [it, inserted] = themes.try_emplace(theme, theme->GetDirectories().size(), false);
+    if (!inserted) return;
+
+    // A reloaded theme gets the watch descriptors of the theme it replaces, its directories being the same inodes.
+    int wd = inotify_add_watch(fd, theme->GetPath().fn_str(), THEME_EVENTS);
+    if (wd >= 0) {
+        targets[wd] = {theme, THEME_ROOT};
+    }
+    wxVector<size_t> added;
+    AddWatches(theme, it->second, added);
+}
+
+void ThemeWatcher::AddWatches(const std::shared_ptr<const IconTheme>& theme, std::vector<bool>& watched, wxVector<size_t>& added) {
+    const auto& directories = theme->GetDirectories();
+    for (size_t i = 0; i < directories.size(); ++i) {
+        if (watched[i]) continue;
+        int wd = inotify_add_watch(fd, directories[i].path.fn_str(), DIRECTORY_EVENTS);
+        if (wd >= 0) {
+            targets[wd] = {theme, i};
+            watched[i] = true;
+            added.push_back(i);
+            continue;
+        }
+        if (errno != ENOENT) continue;
+
+        // Missing, watch its deepest existing parent for its creation. The theme root is watched already.
+        wxString name = directories[i].name;
+        for (int slash = name.Find('/', true); slash > 0; slash = name.Find('/', true)) {
+            name.Truncate(slash);
+            wd = inotify_add_watch(fd, (theme->GetPath() + "/" + name).fn_str(), ANCESTOR_EVENTS);
+            if (wd >= 0) {
+                targets.try_emplace(wd, Target{theme, ANCESTOR});
+                break;
+            }
+        }
+    }
+}
+
+void ThemeWatcher::Run() {
+    alignas(inotify_event) char buffer[16 * 1024];
+    std::set<int> directories;
+    std::set<int> indexFiles;
+    std::set<int> removed;
+    bool overflow = false;
+
+    for (;;) {
+        bool pending = !directories.empty() || !indexFiles.empty() || overflow;
+        pollfd fds[2] = {{fd, POLLIN, 0}, {stopFd, POLLIN, 0}};
+        int ready = poll(fds, 2, pending ? SETTLE_DELAY_MS : -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (fds[1].revents != 0) return;
+
+        if (ready == 0) {
+            Apply(directories, indexFiles, removed, overflow);
+            directories.clear();
+            indexFiles.clear();
+            removed.clear();
+            overflow = false;
+            continue;
+        }
+
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        for (ssize_t offset = 0; offset < length; ) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflow = true;
+            } else if (event->mask & IN_IGNORED) {
+                // The watched directory is gone, forget it once its removal is applied.
+                removed.insert(event->wd);
+            } else if (event->len > 0 && std::strcmp(event->name, "index.theme") == 0) {
+                indexFiles.insert(event->wd);
+            } else {
+                directories.insert(event->wd);
+            }
+        }
+    }
+}
+
+void ThemeWatcher::Apply(const std::set<int>& directories, const std::set<int>& indexFiles, const std::set<int>& removed, bool all) {
+    wxVector<std::pair<std::shared_ptr<const IconTheme>, size_t>> refreshed;
+    wxVector<wxString> changedThemes;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = targets.begin(); it != targets.end(); ) {
+            auto theme = it->second.theme.lock();
+            if (!theme) {
+                // Replaced or removed theme, whose directories are not watched through another one.
+                inotify_rm_watch(fd, it->first);
+                it = targets.erase(it);
+                continue;
+            }
+            size_t directory = it->second.directory;
+            if (directory == THEME_ROOT) {
+                if (indexFiles.count(it->first) != 0) {
+                    changedThemes.push_back(theme->GetPath());
+                }
+            } else if (directory != ANCESTOR && (all || directories.count(it->first) != 0)) {
+                refreshed.push_back({theme, directory});
+            }
+            if (removed.count(it->first) != 0) {
+                // Deleted directory, watched again below if it was recreated in the meantime, or once it is.
+                if (directory != THEME_ROOT && directory != ANCESTOR) {
+                    auto state = themes.find(it->second.theme);
+                    if (state != themes.end()) state->second[directory] = false;
+                }
+                it = targets.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        std::erase_if(themes, [](const auto& state) { return state.first.expired(); });
+
+        // Directories created since, under the theme root or a watched parent, are listed anew.
+        for (auto& [weak, watched] : themes) {
+            auto theme = weak.lock();
+            if (!theme) continue;
+            wxVector<size_t> added;
+            AddWatches(theme, watched, added);
+            for (size_t directory : added) {
+                refreshed.push_back({theme, directory});
+            }
+        }
+    }
+
+    if (refreshed.empty() && changedThemes.empty()) return;
+    for (const auto& [theme, directory] : refreshed) {
+        theme->RefreshDirectory(directory);
+    }
+    callback(changedThemes);
+}
+
+#else
+
+ThemeWatcher::ThemeWatcher(ChangeCallback callback) : callback(std::move(callback)) {}
+
+ThemeWatcher::~ThemeWatcher() {}
+
+void ThemeWatcher::Watch(const std::shared_ptr<const IconTheme>&) {}
+
+#endif // __LINUX__
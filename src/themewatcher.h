@@ -0,0 +1,93 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#ifndef WXFDICONTHEME_THEMEWATCHER_H
+#define WXFDICONTHEME_THEMEWATCHER_H
+
+#include <wx/string.h>
+#include <wx/vector.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+class IconTheme;
+
+/**
+ * Watches theme directories with inotify (Linux only), so long running processes follow package upgrades.
+ *
+ * Icons added to or removed from a directory are patched into the theme index, only this directory
+ * being rescanned. Changes of index.theme are reported to the owner, which reloads the theme.
+ * Directories missing at Watch() time, or deleted later, are watched as soon as they (re)appear.
+ * Events are coalesced until the file system stays quiet for SETTLE_DELAY_MS.
+ */
+class ThemeWatcher {
+public:
+    static constexpr int SETTLE_DELAY_MS = 250;
+
+    /**
+     * Called from the watcher thread once indexes are patched, with the paths of the themes
+     * whose index.theme changed, possibly none.
+     */
+    typedef std::function<void(const wxVector<wxString>& changedThemes)> ChangeCallback;
+
+    explicit ThemeWatcher(ChangeCallback callback);
+    ~ThemeWatcher();
+
+    /** False when inotify is not available, Watch() doing nothing then. */
+    bool IsOk() const { return fd >= 0; }
+
+    /** Watch the theme directory and its icon directories, once per theme. The theme is not kept alive. */
+    void Watch(const std::shared_ptr<const IconTheme>& theme);
+
+private:
+    static constexpr size_t THEME_ROOT = (size_t) -1;
+    static constexpr size_t ANCESTOR = (size_t) -2;
+
+    struct Target {
+        std::weak_ptr<const IconTheme> theme;
+        // Index in the theme directories, THEME_ROOT for the theme directory itself,
+        // ANCESTOR for an existing parent of missing directories
+        size_t directory;
+    };
+
+    ChangeCallback callback;
+    int fd = -1;
+    int stopFd = -1; // Wakes the thread up on destruction
+
+    std::mutex mutex; // Guards targets and themes
+    std::map<int, Target> targets; // By watch descriptor
+    std::map<std::weak_ptr<const IconTheme>, std::vector<bool>, std::owner_less<>> themes; // Watched directories
+
+    std::thread thread;
+
+    void Run();
+    void AddWatches(const std::shared_ptr<const IconTheme>& theme, std::vector<bool>& watched, wxVector<size_t>& added);
+    void Apply(const std::set<int>& directories, const std::set<int>& indexFiles, const std::set<int>& removed, bool all);
+};
+
+#endif //WXFDICONTHEME_THEMEWATCHER_H
@@ -0,0 +1,188 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#include "trace.h"
+
+#include <wx/utils.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Before the registry below, which may start tracing.
+std::atomic<bool> Trace::enabled{false};
+const std::chrono::steady_clock::time_point Trace::epoch = std::chrono::steady_clock::now();
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+};
+
+// Events of a thread, in fixed-size chunks so that published events never move.
+// The owning thread appends, writers read up to the published count.
+struct TraceChunk {
+    static constexpr size_t CAPACITY = 4096;
+    // Per thread, about 100 MB of events. Later spans of the thread are dropped.
+    static constexpr size_t MAX_CHUNKS = 1024;
+    TraceEvent events[CAPACITY];
+    std::atomic<size_t> count{0};
+    std::atomic<TraceChunk*> next{nullptr};
+};
+
+struct ThreadBuffer {
+    int tid;
+    std::unique_ptr<TraceChunk> first{new TraceChunk};
+    TraceChunk* last;
+    size_t chunks = 1;
+
+    explicit ThreadBuffer(int id) : tid(id), last(first.get()) {}
+    ~ThreadBuffer() {
+        std::unique_ptr<TraceChunk> chunk = std::move(first);
+        while (chunk) {
+            chunk.reset(chunk->next.load());
+        }
+    }
+};
+
+// Buffers outlive their threads, so spans of finished threads are still written.
+// Never destroyed, so threads still recording during static destruction don't use freed buffers.
+struct TraceRegistry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::string exitPath;
+
+    TraceRegistry();
+};
+
+TraceRegistry& GetRegistry() {
+    static auto* registry = new TraceRegistry;
+    return *registry;
+}
+
+ThreadBuffer& GetThreadBuffer() {
+    // Registration is the only locking, once per thread.
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (buffer == nullptr) {
+        auto& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.buffers.push_back(std::make_unique<ThreadBuffer>(registry.buffers.size() + 1));
+        buffer = registry.buffers.back().get();
+    }
+    return *buffer;
+}
+
+void AppendEscaped(std::string& out, const char* text) {
+    for (const char* p = text; *p != '\0'; ++p) {
+        if (*p == '"' || *p == '\\') out += '\\';
+        out += *p;
+    }
+}
+
+bool WriteTrace(TraceRegistry& registry, const wxString& path) {
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool firstEvent = true;
+    char number[96];
+    unsigned long pid = wxGetProcessId();
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (const auto& buffer : registry.buffers) {
+            for (TraceChunk* chunk = buffer->first.get(); chunk != nullptr; chunk = chunk->next.load(std::memory_order_acquire)) {
+                size_t count = chunk->count.load(std::memory_order_acquire);
+                for (size_t i = 0; i < count; ++i) {
+                    const auto& event = chunk->events[i];
+                    json += firstEvent ? "\n{\"name\":\"" : ",\n{\"name\":\"";
+                    firstEvent = false;
+                    AppendEscaped(json, event.name);
+                    // Chrome trace times are in microseconds.
+                    snprintf(number, sizeof(number), "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%lu,\"tid\":%d}",
+                             event.start / 1000.0, (event.end - event.start) / 1000.0, pid, buffer->tid);
+                    json += number;
+                }
+            }
+        }
+    }
+    json += "\n]}\n";
+
+    // May run at exit, once wxWidgets is gone, so through the C library.
+    FILE* file = fopen(path.utf8_str(), "w");
+    if (file == nullptr) return false;
+    bool written = fwrite(json.data(), 1, json.size(), file) == json.size();
+    return fclose(file) == 0 && written;
+}
+
+// Writes the trace of WXFDICONTHEME_TRACE. Registered first, so it runs after most static destructors.
+// Spans ending later are dropped.
+void WriteExitTrace() {
+    Trace::Stop();
+    auto& registry = GetRegistry();
+    WriteTrace(registry, wxString::FromUTF8(registry.exitPath.c_str()));
+}
+
+// Registered at load time, so that environment variable tracing covers static initialization of the application.
+const bool registered = (GetRegistry(), true);
+
+} // namespace
+
+TraceRegistry::TraceRegistry() {
+    // Read before wxWidgets is initialized, so through the C library.
+    const char* path = std::getenv("WXFDICONTHEME_TRACE");
+    if (path != nullptr && *path != '\0') {
+        exitPath = path;
+        std::atexit(WriteExitTrace);
+        Trace::Start();
+    }
+}
+
+void Trace::Start() {
+    enabled = true;
+}
+
+void Trace::Stop() {
+    enabled = false;
+}
+
+void Trace::Record(const char* name, uint64_t start, uint64_t end) {
+    if (!IsEnabled()) return;
+    auto& buffer = GetThreadBuffer();
+    TraceChunk* chunk = buffer.last;
+    size_t count = chunk->count.load(std::memory_order_relaxed);
+    if (count == TraceChunk::CAPACITY) {
+        if (buffer.chunks == TraceChunk::MAX_CHUNKS) return;
+        ++buffer.chunks;
+        auto* next = new TraceChunk;
+        chunk->next.store(next, std::memory_order_release);
+        buffer.last = chunk = next;
+        count = 0;
+    }
+    chunk->events[count] = {name, start, end};
+    chunk->count.store(count + 1, std::memory_order_release);
+}
+
+bool Trace::Write(const wxString& path) {
+    return WriteTrace(GetRegistry(), path);
+}
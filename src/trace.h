@@ -0,0 +1,81 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+
+#ifndef WXFDICONTHEME_TRACE_H
+#define WXFDICONTHEME_TRACE_H
+
+#include <wx/string.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Opt-in tracing of the hot paths, written as Chrome trace JSON to be opened in Perfetto or chrome://tracing.
+ *
+ * Enabled at startup by the WXFDICONTHEME_TRACE environment variable, naming the file written at exit,
+ * or by Start(). Each thread records its spans in its own buffer, without locking. When disabled,
+ * a span costs one relaxed atomic load. Buffers are kept until exit, up to about a million spans per thread.
+ */
+class Trace {
+public:
+    static bool IsEnabled() { return enabled.load(std::memory_order_relaxed); }
+    static void Start();
+    static void Stop();
+
+    /** Write the spans recorded so far, by all threads. Can be called while recording. */
+    static bool Write(const wxString& path);
+
+    /** Nanoseconds since the trace epoch. */
+    static uint64_t Now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    /** Record a span of the calling thread. The name must outlive the trace, a string literal in practice. */
+    static void Record(const char* name, uint64_t start, uint64_t end);
+
+private:
+    static std::atomic<bool> enabled;
+    static const std::chrono::steady_clock::time_point epoch;
+};
+
+/** Span covering the scope, if tracing is enabled when it begins. */
+class TraceScope {
+public:
+    explicit TraceScope(const char* spanName) : name(Trace::IsEnabled() ? spanName : nullptr) {
+        if (name != nullptr) start = Trace::Now();
+    }
+    ~TraceScope() {
+        if (name != nullptr) Trace::Record(name, start, Trace::Now());
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name;
+    uint64_t start = 0;
+};
+
+#endif //WXFDICONTHEME_TRACE_H
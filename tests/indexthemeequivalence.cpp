@@ -0,0 +1,133 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+// IndexThemeFile against wxFileConfig, which parsed index.theme files before it, on the keys IconTheme reads.
+// Arguments are directories of .theme files and of themes (holding an index.theme).
+
+#include <wx/init.h>
+#include <wx/dir.h>
+#include <wx/fileconf.h>
+#include <wx/filename.h>
+#include <wx/wfstream.h>
+
+#include "indextheme.h"
+
+#include <cstdio>
+
+namespace {
+
+int failures = 0;
+
+void Fail(const wxString& file, const wxString& what) {
+    ++failures;
+    fprintf(stderr, "FAIL: %s: %s\n", (const char*) file.utf8_str(), (const char*) what.utf8_str());
+}
+
+void CompareValue(const wxString& file, wxFileConfig& config, const IndexThemeFile& parsed,
+                  const wxString& group, const wxString& key) {
+    wxString expected;
+    bool expectedFound = config.Read(group + "/" + key, &expected);
+    auto value = parsed.GetValue(group.utf8_string(), key.utf8_string());
+    if (expectedFound != value.has_value()) {
+        Fail(file, wxString::Format("[%s] %s is %s by wxFileConfig only", group, key, expectedFound ? "found" : "missing"));
+    } else if (value && wxString::FromUTF8(value->data(), value->size()) != expected) {
+        Fail(file, wxString::Format("[%s] %s is '%s' instead of '%s'", group, key,
+                                    wxString::FromUTF8(value->data(), value->size()), expected));
+    }
+}
+
+void CompareFile(const wxString& file) {
+    wxFileInputStream input(file);
+    if (!input.IsOk()) return;
+    wxFileConfig config(input);
+    // Compare raw values, the parser does not expand them.
+    config.SetExpandEnvVars(false);
+
+    IndexThemeFile parsed;
+    if (!parsed.Load(file)) {
+        Fail(file, "cannot be loaded");
+        return;
+    }
+
+    CompareValue(file, config, parsed, "Icon Theme", "Name");
+    CompareValue(file, config, parsed, "Icon Theme", "Inherits");
+    CompareValue(file, config, parsed, "Icon Theme", "Directories");
+
+    auto dirList = parsed.GetValue("Icon Theme", "Directories");
+    if (!dirList) return;
+    for (auto section : IndexThemeFile::SplitList(*dirList)) {
+        wxString group = wxString::FromUTF8(section.data(), section.size());
+        bool expected = config.HasGroup(group);
+        if (expected && !parsed.HasGroup(section)) {
+            // wxFileConfig also has the parents of "a/b" groups, without entries of their own.
+            config.SetPath("/" + group);
+            bool implicit = config.GetNumberOfEntries() == 0;
+            config.SetPath("/");
+            if (implicit) continue;
+        }
+        if (expected != parsed.HasGroup(section)) {
+            Fail(file, wxString::Format("group [%s] is %s by wxFileConfig only", group, expected ? "found" : "missing"));
+            continue;
+        }
+        for (const char* key : {"Size", "MinSize", "MaxSize", "Threshold", "Scale", "Type", "Context"}) {
+            CompareValue(file, config, parsed, group, key);
+        }
+    }
+
+    // Discovery only reads the first group, by blocks.
+    IndexThemeFile header;
+    header.Load(file, "Icon Theme");
+    if (header.GetValue("Icon Theme", "Directories") != dirList) {
+        Fail(file, "Directories differs when only [Icon Theme] is read");
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    wxInitializer initializer(argc, argv);
+    if (!initializer.IsOk()) return 1;
+
+    int compared = 0;
+    for (int arg = 1; arg < argc; ++arg) {
+        wxString dirPath = wxString::FromUTF8(argv[arg]);
+        wxDir dir(dirPath);
+        if (!dir.IsOpened()) continue;
+
+        wxString name;
+        for (bool cont = dir.GetFirst(&name, "*.theme", wxDIR_FILES); cont; cont = dir.GetNext(&name)) {
+            CompareFile(wxFileName(dirPath, name).GetFullPath());
+            ++compared;
+        }
+        for (bool cont = dir.GetFirst(&name, wxEmptyString, wxDIR_DIRS); cont; cont = dir.GetNext(&name)) {
+            wxFileName index(dirPath + "/" + name, "index.theme");
+            if (index.FileExists()) {
+                CompareFile(index.GetFullPath());
+                ++compared;
+            }
+        }
+    }
+
+    printf("%d files compared, %d differences\n", compared, failures);
+    if (compared == 0) return 1;
+    return failures == 0 ? 0 : 1;
+}
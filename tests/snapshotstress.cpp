@@ -0,0 +1,183 @@
+/*
+ * wxFreeDesktopIconTheme - A wxWidgets FreeDesktop Icon Theme support.
+ * Copyright (C) 2025 Emilien KIA
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+// Lookups from many threads while the search paths change, checking the snapshots they run on stay consistent.
+
+#include <wx/init.h>
+
+#include "fdicontheme.h"
+
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include <unistd.h>
+
+namespace {
+
+const int ICON_COUNT = 200;
+const int SIZES[] = {16, 32, 48};
+
+std::atomic<int> failures{0};
+
+void Fail(const char* what, const wxString& detail) {
+    if (failures++ < 20) {
+        fprintf(stderr, "FAIL: %s: %s\n", what, (const char*) detail.utf8_str());
+    }
+}
+
+wxString IconName(int icon) {
+    return wxString::Format("stress-icon-%d", icon);
+}
+
+// A theme inheriting hicolor, each with the icons of half the range, so lookups walk the chain.
+void GenerateThemes(const std::filesystem::path& root) {
+    const char* themes[] = {"stress", "hicolor"};
+    for (int theme = 0; theme < 2; ++theme) {
+        std::filesystem::path themePath = root / themes[theme];
+        std::string dirList;
+        std::string sections;
+        for (int size : SIZES) {
+            std::string dirName = std::to_string(size) + "x" + std::to_string(size) + "/apps";
+            dirList += (dirList.empty() ? "" : ",") + dirName;
+            sections += "\n[" + dirName + "]\nSize=" + std::to_string(size) + "\nType=Fixed\n";
+            std::filesystem::create_directories(themePath / dirName);
+            for (int icon = theme; icon < ICON_COUNT; icon += 2) {
+                // Lookups only need the names, not valid images.
+                std::ofstream(themePath / dirName / (IconName(icon).ToStdString() + ".png"));
+            }
+        }
+        std::ofstream index(themePath / "index.theme");
+        index << "[Icon Theme]\nName=" << themes[theme] << "\n";
+        if (theme == 0) index << "Inherits=hicolor\n";
+        index << "Directories=" << dirList << "\n" << sections;
+    }
+}
+
+// A found file must be the requested icon, and exist: the snapshot it comes from is consistent.
+void Check(const wxString& iconName, const std::optional<wxFileName>& found) {
+    if (!found) return;
+    if (found->GetName() != iconName) {
+        Fail("wrong icon", iconName + " resolved to " + found->GetFullPath());
+    } else if (!found->FileExists()) {
+        Fail("missing file", found->GetFullPath());
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    wxInitializer initializer(argc, argv);
+    if (!initializer.IsOk()) return 1;
+
+    std::filesystem::path root = std::filesystem::temp_directory_path() / ("fdit_stress-" + std::to_string(getpid()));
+    std::filesystem::path otherRoot = root / "other";
+    GenerateThemes(root / "main");
+    GenerateThemes(otherRoot);
+    wxString mainPath = (root / "main").string();
+    wxString otherPath = otherRoot.string();
+
+    FreeDesktopIconProvider provider;
+    provider.SetIndexCacheDirectory(wxEmptyString);
+    provider.SetLookupCacheCapacity(64);
+    provider.AppendPath(mainPath);
+
+    std::vector<wxString> names;
+    for (int icon = 0; icon < ICON_COUNT + 10; ++icon) {
+        names.push_back(IconName(icon)); // The last ones never exist
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> lookups{0};
+    std::atomic<size_t> found{0};
+    std::vector<std::thread> readers;
+    unsigned int readerCount = std::max(4u, std::thread::hardware_concurrency());
+    for (unsigned int t = 0; t < readerCount; ++t) {
+        readers.emplace_back([&, t]() {
+            size_t i = t;
+            while (!stop) {
+                const wxString& iconName = names[i % names.size()];
+                int size = SIZES[i % 3];
+                switch (i % 4) {
+                    case 0: {
+                        auto results = provider.FindIcons("stress", std::span<const wxString>(names).subspan(i % 50, 20), size);
+                        for (size_t n = 0; n < results.size(); ++n) {
+                            Check(names[i % 50 + n], results[n]);
+                        }
+                        lookups += results.size();
+                        break;
+                    }
+                    case 1: {
+                        // Sorted and unique, whatever the snapshot.
+                        wxString last;
+                        provider.ForEachIconName("stress", [&](const char* name) {
+                            wxString current = wxString::FromUTF8(name);
+                            if (!last.IsEmpty() && !(last < current)) Fail("unsorted names", last + " " + current);
+                            last = current;
+                            return true;
+                        });
+                        break;
+                    }
+                    default: {
+                        auto result = provider.FindIcon("stress", iconName, size);
+                        Check(iconName, result);
+                        ++lookups;
+                        if (result) ++found;
+                        break;
+                    }
+                }
+                i += readerCount;
+            }
+        });
+    }
+
+    // Every snapshot change the provider offers, while the readers run.
+    for (int round = 0; round < 300; ++round) {
+        switch (round % 5) {
+            case 0: provider.AppendPath(otherPath); break;
+            case 1: provider.RemovePath(otherPath); break;
+            case 2: provider.PrependPath(otherPath); break;
+            case 3: provider.Clear(); break;
+            case 4: provider.AppendPath(mainPath); provider.SetLookupCacheCapacity(round % 2 ? 0 : 64); break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    stop = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    // Once quiet, the final snapshot resolves every existing icon.
+    provider.Clear();
+    provider.AppendPath(mainPath);
+    for (int icon = 0; icon < ICON_COUNT; ++icon) {
+        if (!provider.FindIcon("stress", IconName(icon), 32)) Fail("not found", IconName(icon));
+    }
+    if (provider.FindIcon("stress", IconName(ICON_COUNT), 32)) Fail("found", IconName(ICON_COUNT));
+
+    std::filesystem::remove_all(root);
+    printf("%zu lookups from %u threads, %zu found, %d failures\n", (size_t) lookups, readerCount, (size_t) found, (int) failures);
+    if (lookups == 0) return 1;
+    return failures == 0 ? 0 : 1;
+}